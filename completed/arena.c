@@ -0,0 +1,78 @@
+/* Arena allocation
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 8 // enough for the pointers and doubles kept in arenas
+
+struct ArenaBlock_
+{
+  struct ArenaBlock_ *next;
+  double data[]; // aligned for anything the arena holds
+};
+
+static void newBlock(Arena *arena, size_t size)
+{
+  // a request too big for a block gets one of its own
+  size_t dataSize = (size > ARENA_BLOCK_SIZE / 4) ? size : ARENA_BLOCK_SIZE;
+  ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + dataSize);
+
+  block->next = arena->blocks;
+  arena->blocks = block;
+  arena->next = (char *)block->data;
+  arena->limit = arena->next + dataSize;
+}
+
+char *arenaAllocChars(Arena *arena, size_t size)
+{
+  char *p;
+
+  if ((size_t)(arena->limit - arena->next) < size)
+    newBlock(arena, size);
+  p = arena->next;
+  arena->next += size;
+  arena->used += size;
+  return p;
+}
+
+void *arenaAlloc(Arena *arena, size_t size)
+{
+  size_t pad = -(uintptr_t)arena->next & (ARENA_ALIGN - 1);
+
+  if ((size_t)(arena->limit - arena->next) < pad + size)
+  {
+    newBlock(arena, size);
+    pad = 0;
+  }
+  arena->next += pad;
+  return arenaAllocChars(arena, size);
+}
+
+char *arenaCopy(Arena *arena, const char *text, size_t length)
+{
+  char *copy = arenaAllocChars(arena, length + 1);
+
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+void freeArena(Arena *arena)
+{
+  while (arena->blocks != NULL)
+  {
+    ArenaBlock *next = arena->blocks->next;
+    free(arena->blocks);
+    arena->blocks = next;
+  }
+  arena->next = arena->limit = NULL;
+  arena->used = 0;
+}
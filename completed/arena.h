@@ -0,0 +1,34 @@
+/* Arena allocation
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/* An arena hands out memory from large blocks by bumping a pointer, and
+ * gives all of it back at once in freeArena. Nothing allocated from it is
+ * freed on its own. An arena that is all zeros is empty and ready to use. */
+
+typedef struct ArenaBlock_ ArenaBlock;
+
+typedef struct
+{
+  ArenaBlock *blocks; // the newest first
+  char *next;         // free space in the newest block
+  char *limit;
+  size_t used;        // bytes handed out
+} Arena;
+
+// Memory for any object of the given size
+void *arenaAlloc(Arena *arena, size_t size);
+// Memory for size characters, with no alignment
+char *arenaAllocChars(Arena *arena, size_t size);
+// A NUL-terminated copy of text[0..length)
+char *arenaCopy(Arena *arena, const char *text, size_t length);
+void freeArena(Arena *arena);
+
+#endif
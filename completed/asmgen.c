@@ -0,0 +1,798 @@
+/* Native code generation
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asmgen.h"
+#include "classes.h"
+#include "kplrt.h"
+#include "token.h"
+
+/* Each routine becomes a function .LR<id>, walked from the syntax tree as
+ * codegen.c walks it for kplvm. A value is 8 bytes, as the runtime keeps
+ * it (kplrt.h), and an expression leaves its value in %rax; the operands
+ * waiting for it are pushed on the machine stack.
+ *
+ * A call pushes the arguments, first to last, then the static link (the
+ * frame of the routine the callee is declared in), and pops them after.
+ * The callee's frame is %rbp: the static link is at 16(%rbp), argument i
+ * of n at 16 + 8 * (n - i), a function's result at -8 and the variables
+ * below it, cleared; an array's first element has the lowest address.
+ * The runtime is called with the stack aligned through %rbx, which main
+ * saves for its caller. */
+
+extern __thread SymTab *symtab;
+extern __thread Ast *ast;
+
+static __thread FILE *output;
+static __thread int level;              // of the routine being compiled; the program's is 0
+static __thread int *cells;             // by ObjectId: a variable's offset from %rbp
+static __thread int forCells;           // the cells below %rbp taken, by FOR loops' final values too
+static __thread int labelCount;
+static __thread int breakLabel;          // where BREAK goes, 0 outside loops and SWITCHes
+static __thread NodeId defaultNode;      // of the innermost SWITCH
+
+#define RESULT_OFFSET (-8)
+
+static int isReference(Object *obj)
+{
+  return (obj->kind == OBJ_PARAMETER) && (obj->paramAttrs->kind == PARAM_REFERENCE);
+}
+
+// Writes an instruction
+static void out(const char *format, ...)
+{
+  va_list args;
+
+  fputc('\t', output);
+  va_start(args, format);
+  vfprintf(output, format, args);
+  va_end(args);
+  fputc('\n', output);
+}
+
+static int newLabel(void)
+{
+  return ++labelCount;
+}
+
+static void placeLabel(int label)
+{
+  fprintf(output, ".L%d:\n", label);
+}
+
+static void callRuntime(const char *function)
+{
+  out("movq %%rsp, %%rbx");
+  out("andq $-16, %%rsp");
+  out("call %s", function);
+  out("movq %%rbx, %%rsp");
+}
+
+/******************************************************************/
+
+// Converts %rax from one TypeClass to another
+static void genConversion(int from, int to)
+{
+  if ((from == to) || (isIntClass(from) && isIntClass(to)))
+    return;
+  if (to == TP_STRING)
+  {
+    out("movq %%rax, %%rdi");
+    out("movl $%d, %%esi", from);
+    callRuntime("kpl_to_string");
+  }
+  else if (to == TP_DOUBLE)
+  {
+    out("cvtsi2sdl %%eax, %%xmm0");
+    out("movq %%xmm0, %%rax");
+  }
+  else if (from == TP_DOUBLE)
+  {
+    // truncated; out of the range of int the conversion gives INT64_MIN
+    out("movq %%rax, %%xmm0");
+    out("cvttsd2siq %%xmm0, %%rax");
+    out("movslq %%eax, %%rcx");
+    out("cmpq %%rax, %%rcx");
+    out("jne .Lerror%d", KPL_INT_OVERFLOW);
+  }
+}
+
+/* Compares %rax with %rcx, both of typeClass, and jumps to .L<prefix><label>
+ * if op gives whenTrue. Doubles compare as kplvm's CMPF does: neither less
+ * nor greater is equal. */
+static void genComparison(int typeClass, int op, int whenTrue, const char *prefix, int label)
+{
+  const char *jump;
+
+  if (typeClass == TP_DOUBLE)
+  {
+    out("movq %%rax, %%xmm0");
+    out("movq %%rcx, %%xmm1");
+    out("ucomisd %%xmm1, %%xmm0");
+    out("seta %%al");
+    out("ucomisd %%xmm0, %%xmm1");
+    out("seta %%cl");
+    out("movzbl %%al, %%eax");
+    out("movzbl %%cl, %%ecx");
+    out("subl %%ecx, %%eax");
+    out("xorl %%ecx, %%ecx");
+  }
+  else if (typeClass == TP_STRING)
+  {
+    out("movq %%rax, %%rdi");
+    out("movq %%rcx, %%rsi");
+    callRuntime("kpl_compare");
+    out("xorl %%ecx, %%ecx");
+  }
+  out("cmpl %%ecx, %%eax");
+
+  switch (op)
+  {
+  case SB_EQ:
+    jump = whenTrue ? "je" : "jne";
+    break;
+  case SB_NEQ:
+    jump = whenTrue ? "jne" : "je";
+    break;
+  case SB_LT:
+    jump = whenTrue ? "jl" : "jge";
+    break;
+  case SB_LE:
+    jump = whenTrue ? "jle" : "jg";
+    break;
+  case SB_GT:
+    jump = whenTrue ? "jg" : "jle";
+    break;
+  default:
+    jump = whenTrue ? "jge" : "jl";
+    break;
+  }
+  out("%s .L%s%d", jump, prefix, label);
+}
+
+static void genExpression(NodeId id);
+
+static void genValue(NodeId id, int typeClass)
+{
+  genExpression(id);
+  genConversion(valueClass(id), typeClass);
+}
+
+static void genConstant(ConstantId id)
+{
+  ConstantValue *value = constantValue(id);
+
+  if (value->type == TP_INT)
+    out("movq $%d, %%rax", value->intValue);
+  else if (value->type == TP_CHAR)
+    out("movq $%d, %%rax", (unsigned char)value->charValue);
+  else if (value->type == TP_DOUBLE)
+    out("movq .LK%d(%%rip), %%rax", id);
+  else
+    out("leaq .LK%d(%%rip), %%rax", id);
+}
+
+// Leaves in %rdx the frame of the routine obj is declared in, and returns
+// the register holding it
+static const char *genFrame(Object *obj)
+{
+  int p = levelsOut(obj, level);
+
+  if (p == 0)
+    return "%rbp";
+  out("movq %%rbp, %%rdx");
+  for (; p > 0; p--)
+    out("movq 16(%%rdx), %%rdx");
+  return "%rdx";
+}
+
+static void genVariableAddress(Object *var)
+{
+  const char *frame;
+
+  // a function's result is only ever set inside the function itself
+  if (var->kind == OBJ_FUNCTION)
+  {
+    out("leaq %d(%%rbp), %%rax", RESULT_OFFSET);
+    return;
+  }
+  frame = genFrame(var);
+  if (isReference(var))
+    out("movq %d(%s), %%rax", cells[var->id], frame);
+  else
+    out("leaq %d(%s), %%rax", cells[var->id], frame);
+}
+
+static void genVariableValue(Object *var)
+{
+  const char *frame = genFrame(var);
+
+  out("movq %d(%s), %%rax", cells[var->id], frame);
+  if (isReference(var))
+    out("movq (%%rax), %%rax");
+}
+
+// Stores %rax in var
+static void genStore(Object *var)
+{
+  const char *frame;
+
+  if (var->kind == OBJ_FUNCTION)
+  {
+    out("movq %%rax, %d(%%rbp)", RESULT_OFFSET);
+    return;
+  }
+  frame = genFrame(var);
+  if (isReference(var))
+  {
+    out("movq %d(%s), %%rdx", cells[var->id], frame);
+    out("movq %%rax, (%%rdx)");
+  }
+  else
+    out("movq %%rax, %d(%s)", cells[var->id], frame);
+}
+
+static void genElementAddress(NodeId id)
+{
+  Object *array = objectOf(getNode(id)->value);
+  Type *type = objectType(array);
+  NodeId index;
+
+  genVariableAddress(array);
+  for (index = getNode(id)->child; index != NO_NODE; index = getNode(index)->sibling)
+  {
+    out("pushq %%rax");
+    genValue(index, TP_INT);
+    // unsigned, so that a negative index is out of range too
+    out("cmpl $%d, %%eax", type->arraySize);
+    out("jae .Lerror%d", KPL_INDEX_OUT_OF_RANGE);
+    type = type->elementType;
+    out("imulq $%d, %%rax, %%rax", 8 * sizeOfType(type));
+    out("popq %%rcx");
+    out("addq %%rcx, %%rax");
+  }
+}
+
+static void genAddress(NodeId id)
+{
+  if (getNode(id)->kind == N_INDEX)
+    genElementAddress(id);
+  else
+    genVariableAddress(objectOf(getNode(id)->value));
+}
+
+static void genCall(Object *callee, NodeId args)
+{
+  NodeId arg;
+  Object *param;
+  const char *frame;
+  int i = 0;
+
+  switch (callee->id)
+  {
+  case READC_ID:
+    callRuntime("kpl_readc");
+    out("movslq %%eax, %%rax");
+    return;
+  case READI_ID:
+    callRuntime("kpl_readi");
+    out("movslq %%eax, %%rax");
+    return;
+  case WRITEI_ID:
+    genValue(args, TP_INT);
+    out("movq %%rax, %%rdi");
+    callRuntime("kpl_writei");
+    return;
+  case WRITEC_ID:
+    genValue(args, TP_CHAR);
+    out("movq %%rax, %%rdi");
+    callRuntime("kpl_writec");
+    return;
+  case WRITED_ID:
+    genValue(args, TP_DOUBLE);
+    out("movq %%rax, %%rdi");
+    callRuntime("kpl_writed");
+    return;
+  case WRITES_ID:
+    genValue(args, TP_STRING);
+    out("movq %%rax, %%rdi");
+    callRuntime("kpl_writes");
+    return;
+  case WRITELN_ID:
+    callRuntime("kpl_writeln");
+    return;
+  default:
+    break;
+  }
+
+  for (arg = args; arg != NO_NODE; arg = getNode(arg)->sibling)
+  {
+    param = getParam(callee, i++);
+    if (param->paramAttrs->kind == PARAM_REFERENCE)
+      genAddress(arg);
+    else
+      genValue(arg, objectType(param)->typeClass);
+    out("pushq %%rax");
+  }
+  frame = genFrame(callee);
+  out("pushq %s", frame);
+  out("call .LR%d", callee->id);
+  out("addq $%d, %%rsp", 8 * (i + 1));
+}
+
+static void genBinary(NodeId id)
+{
+  Node *n = getNode(id);
+  NodeId left = n->child;
+  NodeId right = getNode(left)->sibling;
+  int op = n->op;
+  int typeClass = valueClass(id);
+
+  genValue(left, typeClass);
+  out("pushq %%rax");
+  genValue(right, ((op == SB_POWER) && (typeClass != TP_STRING)) ? TP_INT : typeClass);
+  out("movq %%rax, %%rcx");
+  out("popq %%rax");
+
+  if (typeClass == TP_STRING)
+  {
+    out("movq %%rax, %%rdi");
+    out("movq %%rcx, %%rsi");
+    callRuntime("kpl_concat");
+  }
+  else if (op == SB_POWER)
+  {
+    out((typeClass == TP_DOUBLE) ? "movq %%rax, %%rdi" : "movl %%eax, %%edi");
+    out("movl %%ecx, %%esi");
+    if (typeClass == TP_DOUBLE)
+      callRuntime("kpl_power_double");
+    else
+    {
+      callRuntime("kpl_power");
+      out("movslq %%eax, %%rax");
+    }
+  }
+  else if (typeClass == TP_DOUBLE)
+  {
+    out("movq %%rax, %%xmm0");
+    out("movq %%rcx, %%xmm1");
+    out("%s %%xmm1, %%xmm0", (op == SB_PLUS) ? "addsd" : (op == SB_MINUS) ? "subsd" : (op == SB_TIMES) ? "mulsd" : "divsd");
+    out("movq %%xmm0, %%rax");
+  }
+  else if (op == SB_SLASH)
+  {
+    out("testl %%ecx, %%ecx");
+    out("je .Lerror%d", KPL_DIVISION_BY_ZERO);
+    out("cmpl $-1, %%ecx");
+    out("jne 1f");
+    out("cmpl $-2147483648, %%eax");
+    out("je .Lerror%d", KPL_INT_OVERFLOW);
+    fprintf(output, "1:\n");
+    out("cltd");
+    out("idivl %%ecx");
+    out("movslq %%eax, %%rax");
+  }
+  else
+  {
+    // wraps around, as kplvm's do
+    out("%s %%ecx, %%eax", (op == SB_PLUS) ? "addl" : (op == SB_MINUS) ? "subl" : "imull");
+    out("movslq %%eax, %%rax");
+  }
+}
+
+static void genExpression(NodeId id)
+{
+  Node *n = getNode(id);
+
+  switch (n->kind)
+  {
+  case N_NUMBER:
+  case N_CHAR:
+    out("movq $%d, %%rax", n->value);
+    break;
+  case N_LITERAL:
+    genConstant(n->value);
+    break;
+  case N_CONSTANT:
+    genConstant(objectOf(n->value)->constAttrs->value);
+    break;
+  case N_VARIABLE:
+    genVariableValue(objectOf(n->value));
+    break;
+  case N_INDEX:
+    genElementAddress(id);
+    out("movq (%%rax), %%rax");
+    break;
+  case N_FUNCALL:
+    genCall(objectOf(n->value), n->child);
+    break;
+  case N_NEGATE:
+    genExpression(n->child);
+    if (valueClass(n->child) == TP_DOUBLE)
+      out("btcq $63, %%rax");
+    else
+    {
+      out("negl %%eax");
+      out("movslq %%eax, %%rax");
+    }
+    break;
+  case N_BINARY:
+    genBinary(id);
+    break;
+  default:
+    break;
+  }
+}
+
+// Jumps to label unless the condition holds
+static void genCondition(NodeId id, int label)
+{
+  NodeId left = getNode(id)->child;
+  NodeId right = getNode(left)->sibling;
+  int typeClass = comparisonClass(valueClass(left), valueClass(right));
+
+  genValue(left, typeClass);
+  out("pushq %%rax");
+  genValue(right, typeClass);
+  out("movq %%rax, %%rcx");
+  out("popq %%rax");
+  genComparison(typeClass, getNode(id)->op, 0, "", label);
+}
+
+/******************************************************************/
+
+static void genStatement(NodeId id);
+
+// As codegen.c compiles it: the final value is evaluated once, and the
+// variable compared with it before it is stepped
+static void genFor(NodeId id)
+{
+  Object *var = objectOf(getNode(id)->value);
+  int typeClass = objectType(var)->typeClass;
+  int compareClass = comparisonClass(typeClass, typeClass);
+  NodeId from = getNode(id)->child;
+  NodeId to = getNode(from)->sibling;
+  int savedBreak = breakLabel;
+  int limit = -8 * ++forCells;
+  int test = newLabel();
+  int body = newLabel();
+  int exit = newLabel();
+
+  genValue(from, typeClass);
+  genStore(var);
+  genValue(to, typeClass);
+  out("movq %%rax, %d(%%rbp)", limit);
+
+  placeLabel(test);
+  genVariableValue(var);
+  out("movq %d(%%rbp), %%rcx", limit);
+  genComparison(compareClass, SB_LE, 0, "", exit);
+
+  placeLabel(body);
+  breakLabel = exit;
+  genStatement(getNode(to)->sibling);
+  breakLabel = savedBreak;
+
+  genVariableValue(var);
+  out("movq %d(%%rbp), %%rcx", limit);
+  genComparison(compareClass, SB_LT, 0, "", exit);
+  genVariableValue(var);
+  if (typeClass == TP_DOUBLE)
+  {
+    out("movq %%rax, %%xmm0");
+    out("movl $1, %%ecx");
+    out("cvtsi2sdl %%ecx, %%xmm1");
+    out("addsd %%xmm1, %%xmm0");
+    out("movq %%xmm0, %%rax");
+  }
+  else
+  {
+    out("addl $1, %%eax");
+    out("movslq %%eax, %%rax");
+  }
+  genStore(var);
+  out("jmp .L%d", (typeClass == TP_DOUBLE) ? test : body);
+  placeLabel(exit);
+  forCells--;
+}
+
+// Adds a test for each CASE in the SWITCH's statement, and not in a SWITCH
+// nested in it, jumping to .LC<id> of the CASE, and finds its first DEFAULT
+static void genCaseTests(NodeId id, int switchClass, NodeId *firstDefault)
+{
+  Node *n = getNode(id);
+  ConstantValue *value;
+  int typeClass;
+  NodeId child;
+
+  switch (n->kind)
+  {
+  case N_SWITCH:
+    return;
+  case N_CASE:
+    value = constantValue(n->value);
+    // a string never equals a number
+    if ((value->type == TP_STRING) == (switchClass == TP_STRING))
+    {
+      typeClass = comparisonClass(value->type, switchClass);
+      out("movq (%%rsp), %%rax");
+      genConversion(switchClass, typeClass);
+      out("pushq %%rax");
+      genConstant(n->value);
+      genConversion(value->type, typeClass);
+      out("movq %%rax, %%rcx");
+      out("popq %%rax");
+      genComparison(typeClass, SB_EQ, 1, "C", id);
+    }
+    break;
+  case N_DEFAULT:
+    if (*firstDefault == NO_NODE)
+      *firstDefault = id;
+    break;
+  default:
+    break;
+  }
+  for (child = n->child; child != NO_NODE; child = getNode(child)->sibling)
+    genCaseTests(child, switchClass, firstDefault);
+}
+
+// The value switched on stays pushed while the statement runs
+static void genSwitch(NodeId id)
+{
+  NodeId exp = getNode(id)->child;
+  NodeId savedDefault = defaultNode;
+  int savedBreak = breakLabel;
+  int exit = newLabel();
+
+  genExpression(exp);
+  out("pushq %%rax");
+  defaultNode = NO_NODE;
+  genCaseTests(getNode(exp)->sibling, valueClass(exp), &defaultNode);
+  if (defaultNode != NO_NODE)
+    out("jmp .LC%d", defaultNode);
+  else
+    out("jmp .L%d", exit);
+
+  breakLabel = exit;
+  genStatement(getNode(exp)->sibling);
+  breakLabel = savedBreak;
+  placeLabel(exit);
+  out("addq $8, %%rsp");
+
+  defaultNode = savedDefault;
+}
+
+static void genStatements(NodeId first)
+{
+  NodeId statement;
+
+  for (statement = first; statement != NO_NODE; statement = getNode(statement)->sibling)
+    genStatement(statement);
+}
+
+static void genStatement(NodeId id)
+{
+  Node *n = getNode(id);
+  NodeId child = n->child;
+  int savedBreak, label, exit;
+
+  switch (n->kind)
+  {
+  case N_ASSIGN:
+    if (getNode(child)->kind == N_VARIABLE)
+    {
+      genValue(getNode(child)->sibling, getNode(child)->typeClass);
+      genStore(objectOf(getNode(child)->value));
+    }
+    else
+    {
+      genAddress(child);
+      out("pushq %%rax");
+      genValue(getNode(child)->sibling, getNode(child)->typeClass);
+      out("popq %%rcx");
+      out("movq %%rax, (%%rcx)");
+    }
+    break;
+  case N_CALL:
+    genCall(objectOf(n->value), child);
+    break;
+  case N_GROUP:
+    genStatements(child);
+    break;
+  case N_IF:
+    label = newLabel();
+    genCondition(child, label);
+    child = getNode(child)->sibling;
+    genStatement(child);
+    if (getNode(child)->sibling != NO_NODE)
+    {
+      exit = newLabel();
+      out("jmp .L%d", exit);
+      placeLabel(label);
+      genStatement(getNode(child)->sibling);
+      label = exit;
+    }
+    placeLabel(label);
+    break;
+  case N_WHILE:
+    label = newLabel();
+    exit = newLabel();
+    placeLabel(label);
+    genCondition(child, exit);
+    savedBreak = breakLabel;
+    breakLabel = exit;
+    genStatement(getNode(child)->sibling);
+    breakLabel = savedBreak;
+    out("jmp .L%d", label);
+    placeLabel(exit);
+    break;
+  case N_FOR:
+    genFor(id);
+    break;
+  case N_SWITCH:
+    genSwitch(id);
+    break;
+  case N_CASE:
+    fprintf(output, ".LC%d:\n", id);
+    genStatements(child);
+    break;
+  case N_DEFAULT:
+    fprintf(output, ".LC%d:\n", id);
+    genStatement(child);
+    break;
+  case N_BREAK:
+    // a BREAK outside any loop or SWITCH does nothing
+    if (breakLabel != 0)
+      out("jmp .L%d", breakLabel);
+    break;
+  default:
+    break;
+  }
+}
+
+/******************************************************************/
+
+// Gives the routine's parameters and variables their offsets; returns the
+// cells of its frame below %rbp
+static int layoutFrame(Object *routine)
+{
+  Scope *scope = routineScope(routine);
+  int params = (routine->kind == OBJ_PROGRAM) ? 0 : countParams(routine);
+  int size = -RESULT_OFFSET / 8;
+  Object *obj;
+  int i;
+
+  for (i = 0; i < scope->objectCount; i++)
+  {
+    obj = scopeObject(scope, i);
+    switch (obj->kind)
+    {
+    case OBJ_PARAMETER:
+      cells[obj->id] = 16 + 8 * (params - i);
+      break;
+    case OBJ_VARIABLE:
+      size += sizeOfType(objectType(obj));
+      cells[obj->id] = -8 * size;
+      break;
+    default:
+      break;
+    }
+  }
+  return size;
+}
+
+static void genRoutine(NodeId id)
+{
+  Object *routine = objectOf(getNode(id)->value);
+  NodeId child = getNode(id)->child;
+  int savedLevel = level;
+  int frameSize;
+
+  level = routineLevel(routine);
+  frameSize = layoutFrame(routine);
+
+  for (; getNode(child)->kind == N_ROUTINE; child = getNode(child)->sibling)
+    genRoutine(child);
+  // the FOR loops' final values take the cells below the variables
+  forCells = frameSize;
+  frameSize += forNesting(child);
+
+  fprintf(output, "\n.LR%d:\t# %s\n", routine->id, routine->name);
+  out("pushq %%rbp");
+  out("movq %%rsp, %%rbp");
+  out("subq $%d, %%rsp", 8 * (frameSize + (frameSize & 1)));
+  out("cmpq kpl_stack_limit(%%rip), %%rsp");
+  out("jb .Lerror%d", KPL_STACK_OVERFLOW);
+  out("movq %%rsp, %%rdi");
+  out("movl $%d, %%ecx", frameSize + (frameSize & 1));
+  out("xorl %%eax, %%eax");
+  out("rep stosq");
+  genStatement(child);
+  if (routine->kind == OBJ_FUNCTION)
+    out("movq %d(%%rbp), %%rax", RESULT_OFFSET);
+  out("leave");
+  out("ret");
+  level = savedLevel;
+}
+
+// The doubles and strings, by ConstantId
+static void genPool(void)
+{
+  ConstantPool *constants = &symtab->constants;
+  ConstantValue *value;
+  const unsigned char *c;
+  int i;
+
+  out(".section .rodata");
+  out(".align 8");
+  for (i = 0; i < constants->count; i++)
+  {
+    value = &constants->values[i];
+    if (value->type == TP_DOUBLE)
+    {
+      fprintf(output, ".LK%d:\n", i);
+      out(".double %.17g", value->doubleValue);
+    }
+    else if (value->type == TP_STRING)
+    {
+      fprintf(output, ".LK%d:\n\t.string \"", i);
+      for (c = (const unsigned char *)value->stringValue; *c != '\0'; c++)
+        if ((*c < ' ') || (*c > '~') || (*c == '"') || (*c == '\\'))
+          fprintf(output, "\\%03o", *c);
+        else
+          fputc(*c, output);
+      fprintf(output, "\"\n");
+    }
+  }
+}
+
+void generateAssembly(FILE *file)
+{
+  int err;
+
+  output = file;
+  level = 0;
+  labelCount = 0;
+  breakLabel = 0;
+  defaultNode = NO_NODE;
+  cells = (int *)calloc(symtab->objects.count, sizeof(int));
+  initValueClasses();
+
+  out(".text");
+  out(".globl main");
+  fprintf(output, "main:\n");
+  out("pushq %%rbp");
+  out("movq %%rsp, %%rbp");
+  out("pushq %%rbx");
+  callRuntime("kpl_init");
+  out("pushq $0"); // the program has no static link
+  out("call .LR%d", symtab->program->id);
+  out("addq $8, %%rsp");
+  out("popq %%rbx");
+  out("xorl %%eax, %%eax");
+  out("popq %%rbp");
+  out("ret");
+
+  genRoutine(ast->root);
+
+  fprintf(output, "\n");
+  for (err = KPL_INDEX_OUT_OF_RANGE; err <= KPL_STACK_OVERFLOW; err++)
+  {
+    fprintf(output, ".Lerror%d:\n", err);
+    out("movl $%d, %%edi", err);
+    out("andq $-16, %%rsp");
+    out("call kpl_error");
+  }
+  genPool();
+  out(".section .note.GNU-stack,\"\",@progbits");
+
+  free(cells);
+  cleanValueClasses();
+  output = NULL;
+}
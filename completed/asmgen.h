@@ -0,0 +1,21 @@
+/* Native code generation
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ASMGEN_H__
+#define __ASMGEN_H__
+
+#include <stdio.h>
+
+#include "ast.h"
+#include "symtab.h"
+
+/* Writes the checked program in the thread's syntax tree and symbol table
+ * as x86-64 assembly for the GNU assembler, to be linked with the runtime
+ * (kplrt.h) into a program that prints what kplvm would print running its
+ * bytecode. */
+void generateAssembly(FILE *out);
+
+#endif
@@ -0,0 +1,111 @@
+/* Syntax tree
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+
+#include "ast.h"
+
+// One tree per compilation thread, like the symbol table
+__thread Ast *ast;
+static __thread Ast tree;
+
+extern Type *intType;
+extern Type *charType;
+extern Type *doubleType;
+extern Type *stringType;
+
+#define INITIAL_AST_SIZE 1024
+
+void initAst(void)
+{
+  ast = &tree;
+  ast->nodes = NULL;
+  ast->count = 1; // node 0 stands for NO_NODE
+  ast->capacity = 0;
+  ast->root = NO_NODE;
+}
+
+void cleanAst(void)
+{
+  free(ast->nodes);
+  ast->nodes = NULL;
+  ast = NULL;
+}
+
+NodeId newNode(enum NodeKind kind, int value)
+{
+  Node *node;
+
+  if (ast->count >= ast->capacity)
+  {
+    ast->capacity = (ast->capacity == 0) ? INITIAL_AST_SIZE : ast->capacity * 2;
+    ast->nodes = (Node *)realloc(ast->nodes, ast->capacity * sizeof(Node));
+  }
+  node = &ast->nodes[ast->count];
+  node->kind = kind;
+  node->op = 0;
+  node->typeClass = 0;
+  node->value = value;
+  node->child = NO_NODE;
+  node->sibling = NO_NODE;
+  return ast->count++;
+}
+
+Node *getNode(NodeId id)
+{
+  return &ast->nodes[id];
+}
+
+Type *nodeType(NodeId id)
+{
+  switch (ast->nodes[id].typeClass)
+  {
+  case TP_CHAR:
+    return charType;
+  case TP_DOUBLE:
+    return doubleType;
+  case TP_STRING:
+    return stringType;
+  default:
+    return intType;
+  }
+}
+
+// Expressions only ever have basic types: an array must be indexed
+void setNodeType(NodeId id, Type *type)
+{
+  ast->nodes[id].typeClass = type->typeClass;
+}
+
+void appendNode(NodeList *list, NodeId node)
+{
+  if (node == NO_NODE)
+    return;
+  if (list->first == NO_NODE)
+    list->first = node;
+  else
+    ast->nodes[list->last].sibling = node;
+  list->last = node;
+}
+
+void setChildren(NodeId parent, NodeList *list)
+{
+  ast->nodes[parent].child = list->first;
+}
+
+NodeId childNode(NodeId parent, int i)
+{
+  NodeId node = ast->nodes[parent].child;
+
+  while ((node != NO_NODE) && (i-- > 0))
+    node = ast->nodes[node].sibling;
+  return node;
+}
+
+size_t astMemory(void)
+{
+  return ast->capacity * sizeof(Node);
+}
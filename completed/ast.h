@@ -0,0 +1,114 @@
+/* Syntax tree
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __AST_H__
+#define __AST_H__
+
+#include <stddef.h>
+
+#include "symtab.h"
+
+/* While it checks a program, the parser also builds its syntax tree, for
+ * the passes that come after checking. Declarations are not in the tree:
+ * a node names the objects it uses by ObjectId, and constants by
+ * ConstantId.
+ *
+ * All the nodes of a compilation sit in one array, in the order the parser
+ * finishes them, and refer to each other by index. A node's children form
+ * a chain: child is the first and each one's sibling the next, so a node
+ * takes 16 bytes whatever its number of children, and the tree is one
+ * block that can grow, be copied or be freed in one go. */
+
+// A node's index in the tree; node 0 is never used, so NO_NODE means none
+typedef int NodeId;
+
+#define NO_NODE 0
+
+enum NodeKind
+{
+  // a procedure or function, or the program: its procedures and functions,
+  // then its body
+  N_ROUTINE,
+
+  // statements
+  N_GROUP,   // BEGIN ... END: the statements
+  N_ASSIGN,  // the variable, then the expression
+  N_CALL,    // the arguments
+  N_IF,      // the condition, the statement, and the one after ELSE if any
+  N_WHILE,   // the condition and the statement
+  N_FOR,     // the variable's initial and final values, and the statement
+  N_SWITCH,  // the expression and the statement
+  N_CASE,    // the statements after the constant
+  N_DEFAULT, // the statement
+  N_BREAK,
+  N_EMPTY,   // where a statement must be, but none was written
+
+  // conditions and expressions
+  N_COMPARE, // two expressions compared by op
+  N_BINARY,  // two operands of op: + - * / or **
+  N_NEGATE,  // the operand
+  N_NUMBER,
+  N_CHAR,
+  N_LITERAL,  // a double or string
+  N_CONSTANT, // a declared constant
+  N_VARIABLE, // a variable or parameter, or the result of the function
+  N_INDEX,    // an element of an array variable: its indexes, outermost first
+  N_FUNCALL,  // the arguments
+  NUM_OF_NODE_KINDS
+};
+
+struct Node_
+{
+  unsigned char kind;      // enum NodeKind
+  unsigned char op;        // a TokenType, for N_COMPARE and N_BINARY
+  unsigned char typeClass; // of an expression, as checking sees it
+  // by kind: the N_NUMBER's int or the N_CHAR's character; the ConstantId
+  // of an N_LITERAL or N_CASE; the ObjectId of the N_ROUTINE, the N_CALL's
+  // procedure, the N_FOR's variable or what the other expressions name
+  int value;
+  NodeId child;
+  NodeId sibling;
+};
+
+typedef struct Node_ Node;
+
+struct Ast_
+{
+  Node *nodes; // by NodeId
+  int count;
+  int capacity;
+  NodeId root; // the program's N_ROUTINE, once it is parsed
+};
+
+typedef struct Ast_ Ast;
+
+// While a list of children is built: the first and last nodes in the chain
+typedef struct
+{
+  NodeId first;
+  NodeId last;
+} NodeList;
+
+void initAst(void);
+void cleanAst(void);
+
+NodeId newNode(enum NodeKind kind, int value);
+// Valid until the next node is made
+Node *getNode(NodeId id);
+// The basic type of an expression's typeClass
+Type *nodeType(NodeId id);
+void setNodeType(NodeId id, Type *type);
+
+// Adds node to the end of the list, unless it is NO_NODE
+void appendNode(NodeList *list, NodeId node);
+void setChildren(NodeId parent, NodeList *list);
+// The i-th child of a node, or NO_NODE
+NodeId childNode(NodeId parent, int i);
+
+// Bytes the tree's array takes
+size_t astMemory(void);
+
+#endif
@@ -0,0 +1,42 @@
+#! /bin/bash
+# Compares the scanner of this tree with the one at another git revision.
+#
+#   ./compare.sh [revision] [size]
+#
+# Both scanners are built with -O2 from a clean copy, run over the same
+# genkpl program, and must produce identical token dumps.
+
+REV=${1:-HEAD}
+SIZE=${2:-100M}
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+build() {
+  make -s -C "$1" clean
+  make -s -C "$1" CFLAGS="-c -Wall -O2" bench > /dev/null || exit 1
+}
+
+mkdir -p "$WORK/old" "$WORK/new"
+git -C "$HERE" archive "$REV" . | tar -x -C "$WORK/old"
+if [ ! -f "$WORK/old/bench/scanbench.c" ]; then
+  # revisions older than the benchmark share its scanner interface
+  cp -r "$HERE/bench" "$WORK/old/"
+  cp "$HERE/Makefile" "$WORK/old/"
+fi
+cp -r "$HERE"/*.c "$HERE"/*.h "$HERE"/Makefile "$HERE"/bench "$WORK/new/"
+build "$WORK/old"
+build "$WORK/new"
+
+"$WORK/new/bench/genkpl" "$SIZE" > "$WORK/input.kpl"
+
+if ! cmp -s <("$WORK/old/bench/scanbench" -d "$WORK/input.kpl") \
+            <("$WORK/new/bench/scanbench" -d "$WORK/input.kpl"); then
+  echo "token streams differ"
+  exit 1
+fi
+
+echo "$REV:"
+"$WORK/old/bench/scanbench" "$WORK/input.kpl"
+echo "working tree:"
+"$WORK/new/bench/scanbench" "$WORK/input.kpl"
@@ -0,0 +1,55 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Compiles one file over and over in a single process and reports the
+ * time per compilation, leaving out process start-up. On a small program
+ * such as example1.kpl this is mostly the fixed cost of setting up and
+ * tearing down a compilation. The listing kplc prints goes to /dev/null.
+ *
+ *   compilebench file [rounds]      (default: 100000 rounds)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "reader.h"
+#include "parser.h"
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  long rounds = (argc > 2) ? atol(argv[2]) : 100000;
+  double start, elapsed;
+  long r;
+
+  if (argc <= 1)
+  {
+    printf("compilebench: no input file.\n");
+    return -1;
+  }
+
+  if (freopen("/dev/null", "w", stdout) == NULL)
+    return -1;
+  start = now();
+  for (r = 0; r < rounds; r++)
+    if (compile(argv[1]) == IO_ERROR)
+    {
+      fprintf(stderr, "Can\'t read input file!\n");
+      return -1;
+    }
+  elapsed = now() - start;
+
+  fprintf(stderr, "%s: %ld compilations in %.3f s, %.2f us each\n",
+          argv[1], rounds, elapsed, elapsed / rounds * 1e6);
+  return 0;
+}
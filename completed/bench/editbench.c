@@ -0,0 +1,128 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Checks a program after each of a run of small edits, once in a check
+ * session and once from scratch with compile(), and reports the time per
+ * check both ways. Each edit puts a comment at the start of the line in
+ * the middle of the file or takes it out again, so every version is
+ * valid and the edit falls inside one procedure or function. Writing the
+ * versions out is not timed; the listings go to /dev/null.
+ *
+ *   editbench file [rounds]      (default: 100 rounds)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "session.h"
+
+#define EDIT "(* edited *) "
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *text;
+static long size, editAt;
+
+// Writes the program, with the comment when edited is set
+static void writeVersion(const char *fileName, int edited)
+{
+  FILE *f = fopen(fileName, "w");
+
+  fwrite(text, 1, editAt, f);
+  if (edited)
+    fputs(EDIT, f);
+  fwrite(text + editAt, 1, size - editAt, f);
+  fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+  long rounds = (argc > 2) ? atol(argv[2]) : 100;
+  char fileName[] = "/tmp/editbenchXXXXXX";
+  double start, full = 0, incremental = 0;
+  long checked, reused;
+  CheckSession *session;
+  FILE *f;
+  long r;
+  int fd;
+
+  if (argc <= 1)
+  {
+    printf("editbench: no input file.\n");
+    return -1;
+  }
+  f = fopen(argv[1], "r");
+  if (f == NULL)
+  {
+    fprintf(stderr, "Can\'t read input file!\n");
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  rewind(f);
+  text = (char *)malloc(size);
+  if (fread(text, 1, size, f) != (size_t)size)
+    return -1;
+  fclose(f);
+
+  editAt = size / 2;
+  while ((editAt > 0) && (text[editAt - 1] != '\n'))
+    editAt--;
+
+  fd = mkstemp(fileName);
+  if ((fd < 0) || (freopen("/dev/null", "w", stdout) == NULL))
+    return -1;
+  close(fd);
+
+  session = openSession();
+  writeVersion(fileName, 0);
+  if (recheck(session, fileName) != IO_SUCCESS)
+  {
+    fprintf(stderr, "%s: does not compile\n", argv[1]);
+    return -1;
+  }
+  session->unitsChecked = session->unitsReused = 0;
+
+  for (r = 1; r <= rounds; r++)
+  {
+    writeVersion(fileName, r % 2);
+    start = now();
+    if (recheck(session, fileName) != IO_SUCCESS)
+    {
+      fprintf(stderr, "%s: edit %ld does not compile\n", argv[1], r);
+      return -1;
+    }
+    incremental += now() - start;
+  }
+  checked = session->unitsChecked;
+  reused = session->unitsReused;
+  closeSession(session);
+
+  for (r = 1; r <= rounds; r++)
+  {
+    writeVersion(fileName, r % 2);
+    start = now();
+    compile(fileName);
+    full += now() - start;
+  }
+  remove(fileName);
+
+  fprintf(stderr, "%s: %ld edits at byte %ld\n", argv[1], rounds, editAt);
+  fprintf(stderr, "  compile   %10.1f us per check\n", full / rounds * 1e6);
+  fprintf(stderr, "  recheck   %10.1f us per check, %.1f units checked and %.1f reused\n",
+          incremental / rounds * 1e6, (double)checked / rounds, (double)reused / rounds);
+  return 0;
+}
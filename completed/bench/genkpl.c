@@ -0,0 +1,219 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Writes a syntactically and semantically valid KPL program of roughly the
+ * requested size to stdout, for measuring the scanner and the parser.
+ *
+ *   genkpl [-m mix] <size>[K|M]
+ *
+ * The mix decides which tokens dominate:
+ *   mixed    statements of every kind (the default)
+ *   ident    long identifiers only, no numbers
+ *   comment  a comment block in front of every statement
+ *   numeric  expressions over integer literals
+ *   string   mostly CALL WRITES with string literals; the week2 scanner
+ *            has no strings, so it cannot read these
+ *   decls    mostly declarations: procedures with parameters, constants,
+ *            types and variables of their own, for the symbol table
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_VARS 64
+
+enum Mix
+{
+  MIX_MIXED,
+  MIX_IDENT,
+  MIX_COMMENT,
+  MIX_NUMERIC,
+  MIX_STRING,
+  MIX_DECLS
+};
+
+static const char *mixNames[] = {"mixed", "ident", "comment", "numeric", "string", "decls"};
+
+static enum Mix mix = MIX_MIXED;
+static const char *varPrefix = "Var";
+
+static unsigned long seed = 12345;
+
+static int next(int bound)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (int)((seed >> 16) % bound);
+}
+
+static long parseSize(char *arg)
+{
+  char *end;
+  long size = strtol(arg, &end, 10);
+  if (*end == 'K' || *end == 'k')
+    size *= 1024L;
+  else if (*end == 'M' || *end == 'm')
+    size *= 1024L * 1024L;
+  return size;
+}
+
+static long emitOperand(void)
+{
+  switch (mix)
+  {
+  case MIX_IDENT:
+    return printf("%s%d", varPrefix, next(NUM_VARS));
+  case MIX_NUMERIC:
+    return printf("%d", next(100000000));
+  default:
+    if (next(3) == 0)
+      return printf("%d", next(1000));
+    return printf("%s%d", varPrefix, next(NUM_VARS));
+  }
+}
+
+static long emitExpression(void)
+{
+  static const char *ops[] = {" + ", " - ", " * ", " / "};
+  long n = emitOperand();
+  int terms = (mix == MIX_MIXED) ? next(4) : 2 + next(6);
+  while (terms-- > 0)
+  {
+    n += printf("%s", ops[next(4)]);
+    n += emitOperand();
+  }
+  return n;
+}
+
+static long emitComment(int indent)
+{
+  static const char *words[] = {"the", "generated", "program", "keeps", "every",
+                                "variable", "in", "range", "of", "its", "type"};
+  long n = printf("(*");
+  int lines = 1 + next(4), i, j;
+
+  for (i = 0; i < lines; i++)
+  {
+    for (j = 0; j < 8; j++)
+      n += printf(" %s", words[next(11)]);
+    n += printf("\n%*s", indent + 2, "");
+  }
+  return n + printf("*)\n%*s", indent, "");
+}
+
+static long emitString(void)
+{
+  static const char *words[] = {"Result", "is", "out", "of", "range", "for",
+                                "the", "value", "given", "before", "now"};
+  long n = printf("\"");
+  int count = 2 + next(8), i;
+
+  for (i = 0; i < count; i++)
+    n += printf(i == 0 ? "%s" : " %s", words[next(11)]);
+  return n + printf("\"");
+}
+
+static long emitStatement(int indent)
+{
+  static const char *relops[] = {" = ", " != ", " < ", " <= ", " > ", " >= "};
+  long n = printf("%*s", indent, "");
+
+  if (mix == MIX_COMMENT)
+    n += emitComment(indent);
+  if ((mix == MIX_STRING) && (next(4) != 0))
+  {
+    n += printf("CALL WRITES(");
+    n += emitString();
+    return n + printf(")");
+  }
+
+  switch (next(6))
+  {
+  case 0:
+    n += printf("IF %s%d%s", varPrefix, next(NUM_VARS), relops[next(6)]);
+    n += emitExpression();
+    n += printf(" THEN %s%d := ", varPrefix, next(NUM_VARS));
+    n += emitExpression();
+    n += printf(" ELSE %s%d := ", varPrefix, next(NUM_VARS));
+    n += emitExpression();
+    break;
+  case 1:
+    n += printf("CALL WRITEI(");
+    n += emitExpression();
+    n += printf(")");
+    break;
+  case 2:
+    n += printf("(* step %d of the generated program *)\n%*s", next(100000), indent, "");
+    n += printf("%s%d := ", varPrefix, next(NUM_VARS));
+    n += emitExpression();
+    break;
+  default:
+    n += printf("%s%d := ", varPrefix, next(NUM_VARS));
+    n += emitExpression();
+    break;
+  }
+  return n;
+}
+
+static long emitProcedure(int i)
+{
+  long n = printf("PROCEDURE P%d(A : INTEGER; VAR B : INTEGER);\n", i);
+
+  n += printf("CONST K%d = %d; C%d = 'Q';\n", i, next(1000), i);
+  n += printf("TYPE T%d = ARRAY(. 10 .) OF ARRAY(. 4 .) OF INTEGER;\n", i);
+  n += printf("VAR X : INTEGER; Y : T%d; Z : CHAR;\n", i);
+  n += printf("BEGIN\n  X := A + K%d;\n  Y(. 1 .)(. 2 .) := X;\n  Z := C%d;\n", i, i);
+  n += emitStatement(2);
+  if (i > 0)
+    n += printf(";\n  CALL P%d(X, B)", next(i));
+  return n + printf("\nEND;\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+  long target, written;
+  int i, arg = 1;
+
+  if ((argc > 2) && (strcmp(argv[1], "-m") == 0))
+  {
+    for (i = 0; i < (int)(sizeof(mixNames) / sizeof(mixNames[0])); i++)
+      if (strcmp(argv[2], mixNames[i]) == 0)
+        mix = (enum Mix)i;
+    if (strcmp(argv[2], mixNames[mix]) != 0)
+    {
+      printf("genkpl: unknown mix %s.\n", argv[2]);
+      return -1;
+    }
+    arg = 3;
+  }
+  if (argc <= arg)
+  {
+    printf("genkpl: no size given.\n");
+    return -1;
+  }
+  target = parseSize(argv[arg]);
+  if (mix == MIX_IDENT)
+    varPrefix = "IdentifierNo";
+
+  written = printf("PROGRAM GENERATED;  (* generated by genkpl *)\n");
+  written += printf("CONST LIMIT = %d;\n", 1000);
+  written += printf("VAR\n");
+  for (i = 0; i < NUM_VARS; i++)
+    written += printf("  %s%d : INTEGER;\n", varPrefix, i);
+  written += printf("\n");
+  if (mix == MIX_DECLS)
+    for (i = 0; written < target; i++)
+      written += emitProcedure(i);
+  written += printf("BEGIN\n");
+  written += emitStatement(2);
+  while (written < target)
+  {
+    written += printf(";\n");
+    written += emitStatement(2 + next(3) * 2);
+  }
+  printf("\nEND.\n");
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Times checkKeyword over an identifier-heavy word mix: about one word in
+ * four is a keyword, the rest are typical user identifiers.
+ *
+ *   kwbench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "token.h"
+
+static char *words[] = {
+    "I", "J", "N", "SUM", "COUNT", "TMP", "RESULT", "INDEX", "VAR12", "MAXVALUE",
+    "A", "B", "X1", "Y2", "TOTAL", "FACTORIAL", "HANOI", "OUTPUT", "INPUT", "LIMIT",
+    "BEGIN", "END", "IF", "THEN", "ELSE", "WHILE", "DO", "FOR", "TO", "CALL",
+    "S", "CH", "LEN", "ACCUMULATOR", "STEP", "NEXTITEM", "VALUE", "K", "M", "Z"};
+
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  long rounds = (argc > 1) ? atol(argv[1]) : 1000000;
+  int lengths[NUM_WORDS];
+  long r, keywords = 0;
+  unsigned i;
+  double start, seconds;
+
+  for (i = 0; i < NUM_WORDS; i++)
+    lengths[i] = strlen(words[i]);
+
+  start = now();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < NUM_WORDS; i++)
+      if (checkKeyword(words[i], lengths[i]) != TK_NONE)
+        keywords++;
+  seconds = now() - start;
+
+  printf("%ld lookups, %ld keywords, %.3f s, %.2f ns/lookup\n",
+         rounds * (long)NUM_WORDS, keywords, seconds, seconds * 1e9 / (rounds * NUM_WORDS));
+  return 0;
+}
@@ -0,0 +1,29 @@
+#! /bin/bash
+# Scans one genkpl program from a file (mapped whole) and from a pipe
+# (streamed through a fixed window), and prints the throughput and peak
+# memory of each.
+#
+#   ./pipebench.sh [size]
+#
+# The scanner is built with -O2 from a clean copy. Both runs must dump the
+# same tokens.
+
+SIZE=${1:-100M}
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cp -r "$HERE"/*.c "$HERE"/*.h "$HERE"/Makefile "$HERE"/bench "$WORK/"
+make -s -C "$WORK" clean
+make -s -C "$WORK" CFLAGS="-c -Wall -O2" bench > /dev/null || exit 1
+
+"$WORK/bench/genkpl" "$SIZE" > "$WORK/input.kpl"
+"$WORK/bench/scanbench" -d "$WORK/input.kpl" | md5sum > "$WORK/file.md5"
+cat "$WORK/input.kpl" | "$WORK/bench/scanbench" -d - | md5sum > "$WORK/pipe.md5"
+if ! cmp -s "$WORK/file.md5" "$WORK/pipe.md5"; then
+  echo "token dump read from the pipe differs from the file"
+  exit 1
+fi
+
+echo "file: $("$WORK/bench/scanbench" "$WORK/input.kpl")"
+echo "pipe: $(cat "$WORK/input.kpl" | "$WORK/bench/scanbench" -)"
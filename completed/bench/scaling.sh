@@ -0,0 +1,30 @@
+#! /bin/bash
+# Runs the scanner over one genkpl program with 1 to N lexing threads.
+#
+#   ./scaling.sh [threads] [size]
+#
+# The scanner is built with -O2 from a clean copy. Every run must dump the
+# same tokens as the sequential scanner before its throughput is printed.
+
+MAX=${1:-$(nproc)}
+SIZE=${2:-100M}
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cp -r "$HERE"/*.c "$HERE"/*.h "$HERE"/Makefile "$HERE"/bench "$WORK/"
+make -s -C "$WORK" clean
+make -s -C "$WORK" CFLAGS="-c -Wall -O2" bench > /dev/null || exit 1
+
+"$WORK/bench/genkpl" "$SIZE" > "$WORK/input.kpl"
+"$WORK/bench/scanbench" -d "$WORK/input.kpl" | md5sum > "$WORK/sequential.md5"
+
+echo "sequential: $("$WORK/bench/scanbench" "$WORK/input.kpl")"
+for ((n = 1; n <= MAX; n++)); do
+  "$WORK/bench/scanbench" -j $n -d "$WORK/input.kpl" | md5sum > "$WORK/parallel.md5"
+  if ! cmp -s "$WORK/sequential.md5" "$WORK/parallel.md5"; then
+    echo "$n threads: token dump differs from the sequential scanner"
+    exit 1
+  fi
+  echo "$n threads: $("$WORK/bench/scanbench" -j $n "$WORK/input.kpl")"
+done
@@ -0,0 +1,87 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Times the scanner alone over a source file.
+ *
+ *   scanbench file        prints bytes, tokens and throughput
+ *   scanbench -d file     dumps the token stream with printToken
+ *   scanbench -j N ...    lexes with N threads (lexInParallel)
+ *
+ * A file name of "-" reads stdin as a stream.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "reader.h"
+#include "token.h"
+#include "scanner.h"
+#include "plex.h"
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  ScannerContext scanner;
+  Token *token;
+  char *fileName = NULL;
+  int dump = 0, threads = 0, i;
+  long tokens = 0;
+  size_t bytes;
+  double start, seconds;
+  struct rusage usage;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-d") == 0)
+      dump = 1;
+    else if ((strcmp(argv[i], "-j") == 0) && (i + 1 < argc))
+      threads = atoi(argv[++i]);
+    else
+      fileName = argv[i];
+  }
+  if (fileName == NULL)
+  {
+    printf("scanbench: no input file.\n");
+    return -1;
+  }
+
+  start = now();
+  if (openScanner(&scanner, fileName) == IO_ERROR)
+  {
+    printf("Can\'t read input file!\n");
+    return -1;
+  }
+  if (threads > 0)
+    lexInParallel(&scanner, threads);
+
+  do
+  {
+    token = getToken(&scanner);
+    tokens++;
+    if (dump)
+      printToken(token);
+  } while (token->tokenType != TK_EOF);
+  bytes = scanner.input.consumed + scanner.input.size;
+  closeScanner(&scanner);
+  seconds = now() - start;
+
+  if (!dump)
+  {
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%zu bytes, %ld tokens, %.3f s, %.1f MB/s, %.2f Mtokens/s, %ld KB peak RSS\n",
+           bytes, tokens, seconds, bytes / seconds / 1e6, tokens / seconds / 1e6, usage.ru_maxrss);
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+#! /bin/bash
+# Measures the week2 scanner and the completed scanner over genkpl programs
+# of each token mix.
+#
+#   ./suite.sh [size]
+#
+# Both trees are built with -O2 from a clean copy. The week2 scanner
+# prints every token, so it is timed with its output going to /dev/null,
+# next to the completed scanner doing the same (scanbench -d). The last
+# column is the completed scanner alone (scanbench). A scanner that stops
+# on a token it does not know is shown as n/a.
+
+SIZE=${1:-20M}
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+TIMEFORMAT=%R
+
+mkdir -p "$WORK/week2" "$WORK/completed"
+cp "$HERE"/../week2/*.c "$HERE"/../week2/*.h "$HERE"/../week2/Makefile "$WORK/week2/"
+cp -r "$HERE"/*.c "$HERE"/*.h "$HERE"/Makefile "$HERE"/bench "$WORK/completed/"
+for tree in week2 completed; do
+  make -s -C "$WORK/$tree" clean
+  make -s -C "$WORK/$tree" CFLAGS="-c -Wall -O2" all > /dev/null 2>&1 || exit 1
+done
+make -s -C "$WORK/completed" CFLAGS="-c -Wall -O2" bench > /dev/null || exit 1
+
+# rate BYTES TOKENS SECONDS
+rate() {
+  awk -v b="$1" -v t="$2" -v s="$3" 'BEGIN { printf "%7.1f MB/s %6.2f Mtok/s", b / s / 1e6, t / s / 1e6 }'
+}
+
+# timed COMMAND...: runs it with stdout to /dev/null, prints seconds or FAIL
+timed() {
+  local seconds
+  seconds=$( { time "$@" > /dev/null 2>&1; } 2>&1 ) || { echo FAIL; return; }
+  echo "$seconds"
+}
+
+printf "%-8s %10s %10s  %-30s %-30s %-30s\n" mix bytes tokens "week2 (printing)" "completed (printing)" "completed (scan only)"
+for mix in mixed ident comment numeric string; do
+  input="$WORK/$mix.kpl"
+  "$WORK/completed/bench/genkpl" -m $mix "$SIZE" > "$input"
+  # the week2 scanner never gets past blanks at the end of its input
+  truncate -s -1 "$input"
+  bytes=$(stat -c %s "$input")
+  tokens=$("$WORK/completed/bench/scanbench" "$input" | sed 's/.* bytes, \([0-9]*\) tokens.*/\1/')
+
+  week2=$(timed "$WORK/week2/scanner" "$input")
+  # the week2 scanner prints no TK_EOF
+  if [ "$week2" != FAIL ] && [ "$("$WORK/week2/scanner" "$input" | wc -l)" -eq $((tokens - 1)) ]; then
+    week2=$(rate "$bytes" "$tokens" "$week2")
+  else
+    week2="n/a"
+  fi
+  printing=$(rate "$bytes" "$tokens" "$(timed "$WORK/completed/bench/scanbench" -d "$input")")
+  scanning=$(rate "$bytes" "$tokens" "$("$WORK/completed/bench/scanbench" "$input" | sed 's/.*tokens, \([0-9.]*\) s.*/\1/')")
+
+  printf "%-8s %10d %10d  %-30s %-30s %-30s\n" $mix "$bytes" "$tokens" "$week2" "$printing" "$scanning"
+done
@@ -0,0 +1,178 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Times the symbol table on one crowded scope, the way the parser uses it:
+ * every declaration is checked with checkFreshIdent first, and every name
+ * is then looked up with checkDeclaredVariable from a procedure nested in
+ * the program, so each lookup also misses in the inner scope. Names are
+ * interned beforehand, as the scanner would have done. Then the scope is
+ * walked in order, reading each object's kind and type as printScope or a
+ * later pass would, and left with exitBlock.
+ *
+ * With -n it times deep nesting instead: procedures nested the given
+ * number of levels, each declaring a few locals, and lookups from the
+ * innermost one of a variable declared by the program.
+ *
+ *   symbench [declarations...]      (default: 10000 100000)
+ *   symbench -n depth...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "symtab.h"
+#include "semantics.h"
+#include "intern.h"
+
+extern __thread SymTab *symtab;
+__thread Token *currentToken; // where semantic errors would be reported
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define WALK_ROUNDS 10
+
+static void run(int count)
+{
+  Object *program, *proc, *obj;
+  const char **names = (const char **)malloc(count * sizeof(const char *));
+  char name[MAX_IDENT_LEN + 1];
+  double start, declaring, looking, walking, leaving;
+  Scope *scope;
+  long ints = 0;
+  int i, round;
+
+  for (i = 0; i < count; i++)
+    names[i] = internName(name, sprintf(name, "V%d", i));
+
+  initSymTab();
+  program = createProgramObject(internName("BENCH", 5));
+  enterBlock(program->progAttrs->scope);
+
+  start = now();
+  for (i = 0; i < count; i++)
+  {
+    checkFreshIdent(names[i]);
+    obj = createVariableObject(names[i]);
+    setObjectType(obj, makeIntType());
+    declareObject(obj);
+  }
+  declaring = now() - start;
+
+  proc = createProcedureObject(internName("INNER", 5));
+  declareObject(proc);
+  enterBlock(proc->procAttrs->scope);
+
+  start = now();
+  for (i = 0; i < count; i++)
+    checkDeclaredVariable(names[(int)((i * 7919L) % count)]);
+  looking = now() - start;
+
+  exitBlock();
+
+  scope = program->progAttrs->scope;
+  start = now();
+  for (round = 0; round < WALK_ROUNDS; round++)
+    for (i = 0; i < scope->objectCount; i++)
+    {
+      ObjectId id = scope->objects[i];
+      if ((symtab->objects.kinds[id] == OBJ_VARIABLE) && (symtab->objects.types[id]->typeClass == TP_INT))
+        ints++;
+    }
+  walking = (now() - start) / WALK_ROUNDS;
+
+  start = now();
+  exitBlock();
+  leaving = now() - start;
+  cleanSymTab();
+
+  printf("%d declarations: declare %.3f s (%.0f ns each), look up %.3f s (%.0f ns each)\n",
+         count, declaring, declaring / count * 1e9, looking, looking / count * 1e9);
+  printf("  walk %.2f ms (%.1f ns each, %ld ints), exit %.2f ms (%.0f ns each)\n",
+         walking * 1e3, walking / count * 1e9, ints / WALK_ROUNDS, leaving * 1e3, leaving / count * 1e9);
+  printf("  %d names in %zu bytes, %zu bytes per Object\n",
+         countNames(), namesMemory(), sizeof(Object));
+
+  freeNames();
+  free(names);
+}
+
+#define NESTED_LOCALS 4
+#define NESTED_LOOKUPS 1000000
+
+static void runNested(int depth)
+{
+  Object *program, *proc, *obj;
+  const char *target = internName("TARGET", 6);
+  char name[MAX_IDENT_LEN + 1];
+  double start, looking;
+  int i, j;
+
+  initSymTab();
+  program = createProgramObject(internName("BENCH", 5));
+  enterBlock(program->progAttrs->scope);
+  obj = createVariableObject(target);
+  setObjectType(obj, makeIntType());
+  declareObject(obj);
+
+  for (i = 0; i < depth; i++)
+  {
+    proc = createProcedureObject(internName(name, sprintf(name, "P%d", i)));
+    declareObject(proc);
+    enterBlock(proc->procAttrs->scope);
+    for (j = 0; j < NESTED_LOCALS; j++)
+    {
+      obj = createVariableObject(internName(name, sprintf(name, "L%d", j)));
+      setObjectType(obj, makeIntType());
+      declareObject(obj);
+    }
+  }
+
+  start = now();
+  for (i = 0; i < NESTED_LOOKUPS; i++)
+    checkDeclaredVariable(target);
+  looking = now() - start;
+
+  for (i = 0; i < depth; i++)
+    exitBlock();
+  exitBlock();
+  cleanSymTab();
+  freeNames();
+
+  printf("nesting depth %d: look up %.3f s (%.1f ns each)\n",
+         depth, looking, looking / NESTED_LOOKUPS * 1e9);
+}
+
+int main(int argc, char *argv[])
+{
+  static Token token;
+  int nested = 0;
+  int i;
+
+  token.lineNo = token.colNo = 0;
+  currentToken = &token;
+
+  if (argc > 1 && strcmp(argv[1], "-n") == 0)
+    nested = 1;
+
+  if (argc <= 1)
+  {
+    run(10000);
+    run(100000);
+  }
+  for (i = 1 + nested; i < argc; i++)
+    if (nested)
+      runNested(atoi(argv[i]));
+    else
+      run(atoi(argv[i]));
+  return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Runs KPL programs on the stack machine with each way of dispatching
+ * instructions (see vm.h) and reports the instructions run per second.
+ * Each program is compiled in the process, as kplc -b would, and run the
+ * given number of rounds with each dispatch; the fastest round counts.
+ * What kplc and the programs print goes to /dev/null.
+ *
+ *   vmbench [-r rounds] file...      (default: 3 rounds)
+ *
+ * bench/vm holds compute-heavy programs for it: nested FOR loops, array
+ * sums, recursion, doubles, a sieve, and a grid indexed by constant
+ * arithmetic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "bytecode.h"
+#include "vm.h"
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  char codeFile[] = "/tmp/vmbenchXXXXXX";
+  int rounds = 3;
+  int arg = 1;
+  Bytecode bytecode;
+  long long executed[NUM_OF_DISPATCHES];
+  double best[NUM_OF_DISPATCHES];
+  double start, elapsed;
+  int fd, d, r;
+
+  if (argc > arg + 1 && strcmp(argv[arg], "-r") == 0)
+  {
+    rounds = atoi(argv[arg + 1]);
+    arg += 2;
+  }
+  if (argc <= arg || rounds < 1)
+  {
+    printf("vmbench: no input file.\n");
+    return -1;
+  }
+
+  if ((fd = mkstemp(codeFile)) < 0)
+    return -1;
+  close(fd);
+  if (freopen("/dev/null", "w", stdout) == NULL)
+    return -1;
+  bytecodeFile = codeFile;
+
+  fprintf(stderr, "%-14s %-9s %14s %10s %12s\n", "program", "dispatch", "instructions", "best s", "Mops/s");
+  for (; arg < argc; arg++)
+  {
+    if ((compile(argv[arg]) != IO_SUCCESS) || (loadBytecode(&bytecode, codeFile) == IO_ERROR))
+    {
+      fprintf(stderr, "%s: does not compile\n", argv[arg]);
+      continue;
+    }
+
+    for (d = 0; d < NUM_OF_DISPATCHES; d++)
+    {
+      best[d] = 0;
+      for (r = 0; r < rounds; r++)
+      {
+        start = now();
+        if (runBytecode(&bytecode, d, &executed[d]) != VM_SUCCESS)
+          fprintf(stderr, "%s: runtime error\n", argv[arg]);
+        elapsed = now() - start;
+        if ((r == 0) || (elapsed < best[d]))
+          best[d] = elapsed;
+      }
+      fprintf(stderr, "%-14s %-9s %14lld %10.3f %12.1f\n", argv[arg], dispatchNames[d], executed[d], best[d],
+              executed[d] / best[d] / 1e6);
+    }
+    fprintf(stderr, "%-14s threaded/switch speed-up %.2fx\n", argv[arg], best[DISPATCH_SWITCH] / best[DISPATCH_THREADED]);
+    freeBytecode(&bytecode);
+  }
+
+  unlink(codeFile);
+  return 0;
+}
@@ -0,0 +1,19 @@
+#! /bin/bash
+# Runs the programs in bench/vm on the stack machine with switch and with
+# threaded dispatch, and reports the instructions run per second by each.
+#
+#   ./vmsuite.sh [rounds]
+#
+# The tree is built with -O2 from a clean copy. A non-GNU compiler, or
+# -DVM_NO_THREADED, runs threaded dispatch as switch dispatch.
+
+ROUNDS=${1:-3}
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cp -r "$HERE"/*.c "$HERE"/*.h "$HERE"/Makefile "$HERE"/bench "$WORK/"
+make -s -C "$WORK" clean
+make -s -C "$WORK" CFLAGS="-c -Wall -O2" bench/vmbench > /dev/null 2>&1 || exit 1
+
+cd "$HERE/bench/vm" && "$WORK/bench/vmbench" -r "$ROUNDS" *.kpl
@@ -0,0 +1,288 @@
+/* Stack machine code
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "bytecode.h"
+
+#define INITIAL_CODE_SIZE 1024
+
+static const char magic[4] = {'K', 'P', 'L', 'B'};
+#define BYTECODE_VERSION 1
+
+static const char *opNames[NUM_OF_OPCODES] = {
+    "LA", "LV", "LC", "LK", "LI", "ST", "INT", "DCT", "J", "FJ", "HL", "CALL", "EP", "EF", "CP", "IX",
+    "AD", "SB", "ML", "DV", "PW", "NEG", "EQ", "NE", "GT", "LT", "GE", "LE",
+    "ADF", "SBF", "MLF", "DVF", "PWF", "NEGF", "CMPF", "CMPS", "CAT", "CVD", "CVI", "CVS",
+    "RC", "RI", "WRC", "WRI", "WRD", "WRS", "WLN"};
+
+void initBytecode(Bytecode *bytecode)
+{
+  memset(bytecode, 0, sizeof(Bytecode));
+}
+
+void freeBytecode(Bytecode *bytecode)
+{
+  int i;
+
+  for (i = 0; i < bytecode->poolSize; i++)
+    free(bytecode->pool[i].stringValue);
+  free(bytecode->pool);
+  free(bytecode->code);
+  initBytecode(bytecode);
+}
+
+int emit(Bytecode *bytecode, enum OpCode op, int p, int q)
+{
+  Instruction *instruction;
+
+  if (bytecode->codeSize == bytecode->codeCapacity)
+  {
+    bytecode->codeCapacity = (bytecode->codeCapacity == 0) ? INITIAL_CODE_SIZE : bytecode->codeCapacity * 2;
+    bytecode->code = (Instruction *)realloc(bytecode->code, bytecode->codeCapacity * sizeof(Instruction));
+  }
+  instruction = &bytecode->code[bytecode->codeSize];
+  instruction->op = op;
+  instruction->p = p;
+  instruction->q = q;
+  return bytecode->codeSize++;
+}
+
+/******************************************************************/
+
+/* The file is the magic and version, the code, and the pool. Numbers are
+ * little-endian: an instruction takes 8 bytes (op, an unused byte, p in
+ * 2 and q in 4), a double 8, and a string its length in 4 before its
+ * characters. */
+
+static void putWord(FILE *f, uint32_t word, int bytes)
+{
+  int i;
+
+  for (i = 0; i < bytes; i++)
+    fputc((word >> (8 * i)) & 0xFF, f);
+}
+
+static int getWord(FILE *f, uint32_t *word, int bytes)
+{
+  int i, c;
+
+  *word = 0;
+  for (i = 0; i < bytes; i++)
+  {
+    if ((c = fgetc(f)) == EOF)
+      return 0;
+    *word |= (uint32_t)c << (8 * i);
+  }
+  return 1;
+}
+
+int saveBytecode(Bytecode *bytecode, const char *fileName)
+{
+  FILE *f = fopen(fileName, "wb");
+  struct stat st;
+  uint64_t bits;
+  size_t length;
+  int i, ok, regular;
+
+  if (f == NULL)
+    return IO_ERROR;
+  regular = (fstat(fileno(f), &st) == 0) && S_ISREG(st.st_mode);
+
+  fwrite(magic, 1, sizeof(magic), f);
+  putWord(f, BYTECODE_VERSION, 4);
+  putWord(f, bytecode->codeSize, 4);
+  for (i = 0; i < bytecode->codeSize; i++)
+  {
+    putWord(f, bytecode->code[i].op, 2);
+    putWord(f, bytecode->code[i].p, 2);
+    putWord(f, (uint32_t)bytecode->code[i].q, 4);
+  }
+  putWord(f, bytecode->poolSize, 4);
+  for (i = 0; i < bytecode->poolSize; i++)
+  {
+    putWord(f, bytecode->pool[i].isString, 1);
+    if (bytecode->pool[i].isString)
+    {
+      length = strlen(bytecode->pool[i].stringValue);
+      putWord(f, length, 4);
+      fwrite(bytecode->pool[i].stringValue, 1, length, f);
+    }
+    else
+    {
+      memcpy(&bits, &bytecode->pool[i].doubleValue, sizeof(bits));
+      putWord(f, (uint32_t)bits, 4);
+      putWord(f, (uint32_t)(bits >> 32), 4);
+    }
+  }
+  ok = !ferror(f);
+  if (fclose(f) != 0)
+    ok = 0;
+  // what was written of a file is removed, but not a device or pipe
+  if (!ok && regular)
+    remove(fileName);
+  return ok ? IO_SUCCESS : IO_ERROR;
+}
+
+// Whether every operand points somewhere it may: the machine takes the
+// code as it is
+static int checkBytecode(Bytecode *bytecode)
+{
+  Instruction *instruction;
+  int i;
+
+  for (i = 0; i < bytecode->codeSize; i++)
+  {
+    instruction = &bytecode->code[i];
+    switch (instruction->op)
+    {
+    case OP_J:
+    case OP_FJ:
+    case OP_CALL:
+      if ((instruction->q < 0) || (instruction->q >= bytecode->codeSize))
+        return 0;
+      break;
+    case OP_LK:
+      if ((instruction->q < 0) || (instruction->q >= bytecode->poolSize))
+        return 0;
+      break;
+    case OP_INT:
+    case OP_DCT:
+    case OP_LA:
+    case OP_LV:
+    case OP_IX:
+      if (instruction->q < 0)
+        return 0;
+      break;
+    default:
+      if (instruction->op >= NUM_OF_OPCODES)
+        return 0;
+      break;
+    }
+  }
+  // the code must end in a jump, return or stop, not run off its end
+  return (bytecode->codeSize > 0) &&
+         ((bytecode->code[bytecode->codeSize - 1].op == OP_HL) || (bytecode->code[bytecode->codeSize - 1].op == OP_J) ||
+          (bytecode->code[bytecode->codeSize - 1].op == OP_EP) || (bytecode->code[bytecode->codeSize - 1].op == OP_EF));
+}
+
+static int readBytecode(Bytecode *bytecode, FILE *f)
+{
+  char header[sizeof(magic)];
+  uint32_t word, high, count;
+  uint64_t bits;
+  int i;
+
+  if ((fread(header, 1, sizeof(header), f) != sizeof(header)) || (memcmp(header, magic, sizeof(magic)) != 0) ||
+      !getWord(f, &word, 4) || (word != BYTECODE_VERSION) || !getWord(f, &word, 4) || (word > INT32_MAX / sizeof(Instruction)))
+    return 0;
+
+  bytecode->codeSize = bytecode->codeCapacity = word;
+  bytecode->code = (Instruction *)malloc((word + 1) * sizeof(Instruction));
+  for (i = 0; i < bytecode->codeSize; i++)
+  {
+    if (!getWord(f, &word, 2))
+      return 0;
+    bytecode->code[i].op = (word < NUM_OF_OPCODES) ? word : NUM_OF_OPCODES;
+    if (!getWord(f, &word, 2))
+      return 0;
+    bytecode->code[i].p = word;
+    if (!getWord(f, &word, 4))
+      return 0;
+    bytecode->code[i].q = (int)word;
+  }
+
+  if (!getWord(f, &count, 4) || (count > INT32_MAX / sizeof(PooledValue)))
+    return 0;
+  bytecode->pool = (PooledValue *)calloc(count + 1, sizeof(PooledValue));
+  for (bytecode->poolSize = 0; bytecode->poolSize < (int)count; bytecode->poolSize++)
+  {
+    PooledValue *value = &bytecode->pool[bytecode->poolSize];
+    uint32_t length;
+
+    if (!getWord(f, &length, 1))
+      return 0;
+    value->isString = length;
+    if (value->isString)
+    {
+      if (!getWord(f, &length, 4) || (length > INT32_MAX))
+        return 0;
+      value->stringValue = (char *)malloc(length + 1);
+      if (fread(value->stringValue, 1, length, f) != length)
+        return 0;
+      value->stringValue[length] = '\0';
+    }
+    else
+    {
+      if (!getWord(f, &word, 4) || !getWord(f, &high, 4))
+        return 0;
+      bits = ((uint64_t)high << 32) | word;
+      memcpy(&value->doubleValue, &bits, sizeof(bits));
+    }
+  }
+  return checkBytecode(bytecode);
+}
+
+int loadBytecode(Bytecode *bytecode, const char *fileName)
+{
+  FILE *f = fopen(fileName, "rb");
+  int ok;
+
+  initBytecode(bytecode);
+  if (f == NULL)
+    return IO_ERROR;
+  ok = readBytecode(bytecode, f);
+  fclose(f);
+  if (!ok)
+  {
+    freeBytecode(bytecode);
+    return IO_ERROR;
+  }
+  return IO_SUCCESS;
+}
+
+void printBytecode(Bytecode *bytecode)
+{
+  Instruction *instruction;
+  int i;
+
+  for (i = 0; i < bytecode->codeSize; i++)
+  {
+    instruction = &bytecode->code[i];
+    printf("%6d:  %-5s", i, opNames[instruction->op]);
+    switch (instruction->op)
+    {
+    case OP_LA:
+    case OP_LV:
+    case OP_CALL:
+    case OP_INT:
+      printf("%d, %d", instruction->p, instruction->q);
+      break;
+    case OP_LK:
+      if (bytecode->pool[instruction->q].isString)
+        printf("%d  (\"%s\")", instruction->q, bytecode->pool[instruction->q].stringValue);
+      else
+        printf("%d  (%g)", instruction->q, bytecode->pool[instruction->q].doubleValue);
+      break;
+    case OP_LC:
+    case OP_DCT:
+    case OP_J:
+    case OP_FJ:
+    case OP_IX:
+    case OP_CVS:
+      printf("%d", instruction->q);
+      break;
+    default:
+      break;
+    }
+    printf("\n");
+  }
+}
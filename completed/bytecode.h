@@ -0,0 +1,125 @@
+/* Stack machine code
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __BYTECODE_H__
+#define __BYTECODE_H__
+
+/* kplc compiles a program for a stack machine, which kplvm runs (vm.h).
+ * The machine's memory is a stack of cells, each holding one int, char,
+ * double or string; an array takes a cell per element, and an address is
+ * a cell's index. t is the top of the stack, b the base of the running
+ * routine's frame and pc the instruction to run.
+ *
+ * A frame starts with four cells: the function's result (RV), the caller's
+ * frame (DL, the dynamic link), the instruction to return to (RA) and the
+ * frame of the routine the callee is declared in (SL, the static link).
+ * Parameters and local variables follow. Variables are reached through
+ * the static links: "LV p, q" loads the cell q of the frame p links out.
+ *
+ * A call reserves the four cells, pushes the arguments behind them, pops
+ * all of them again and calls; the callee's INT then takes back the frame,
+ * arguments and all, and adds its variables, cleared. */
+
+#define FRAME_RV 0
+#define FRAME_DL 1
+#define FRAME_RA 2
+#define FRAME_SL 3
+#define FRAME_HEADER 4 // the first parameter's cell
+
+enum OpCode
+{
+  OP_LA,   // LA p, q    push the address of cell q, p frames out
+  OP_LV,   // LV p, q    push the value of that cell
+  OP_LC,   // LC q       push the int (or char) q
+  OP_LK,   // LK q       push the double or string q of the constant pool
+  OP_LI,   //            replace the address on top by the value there
+  OP_ST,   //            store the value on top at the address below it
+  OP_INT,  // INT p, q   add q cells to the stack, clearing all but the first p
+  OP_DCT,  // DCT q      drop q cells
+  OP_J,    // J q        jump to q
+  OP_FJ,   // FJ q       pop an int, and jump to q if it is 0
+  OP_HL,   //            stop
+  OP_CALL, // CALL p, q  call the routine at q, declared p frames out
+  OP_EP,   //            return from a procedure
+  OP_EF,   //            return from a function, leaving its result
+  OP_CP,   //            push a copy of the top
+  OP_IX,   // IX q       check that the index on top is in [0, q)
+
+  // ints and chars
+  OP_AD,
+  OP_SB,
+  OP_ML,
+  OP_DV,
+  OP_PW,
+  OP_NEG,
+  OP_EQ, // comparisons push 1 or 0
+  OP_NE,
+  OP_GT,
+  OP_LT,
+  OP_GE,
+  OP_LE,
+
+  // doubles and strings
+  OP_ADF,
+  OP_SBF,
+  OP_MLF,
+  OP_DVF,
+  OP_PWF,  // a double to an int power
+  OP_NEGF,
+  OP_CMPF, // push -1, 0 or 1 as the double below is less, equal or greater
+  OP_CMPS, // likewise for strings
+  OP_CAT,
+  OP_CVD,  // int on top to double
+  OP_CVI,  // double on top to int, truncated
+  OP_CVS,  // CVS q     the value on top, of TypeClass q, to a string
+
+  // the built-ins
+  OP_RC,
+  OP_RI,
+  OP_WRC,
+  OP_WRI,
+  OP_WRD,
+  OP_WRS,
+  OP_WLN,
+  NUM_OF_OPCODES
+};
+
+typedef struct
+{
+  unsigned char op; // enum OpCode
+  unsigned short p;
+  int q;
+} Instruction;
+
+// The doubles and strings the code loads with LK, as kplvm reads them
+typedef struct
+{
+  int isString;
+  double doubleValue;
+  char *stringValue; // NUL-terminated
+} PooledValue;
+
+typedef struct
+{
+  Instruction *code; // starts running at 0
+  int codeSize;
+  int codeCapacity;
+  PooledValue *pool;
+  int poolSize;
+} Bytecode;
+
+void initBytecode(Bytecode *bytecode);
+void freeBytecode(Bytecode *bytecode);
+// Appends an instruction and returns its address
+int emit(Bytecode *bytecode, enum OpCode op, int p, int q);
+
+// Writes and reads the file kplvm runs; both return IO_SUCCESS or IO_ERROR.
+// A regular file that cannot be written in full is removed.
+int saveBytecode(Bytecode *bytecode, const char *fileName);
+int loadBytecode(Bytecode *bytecode, const char *fileName);
+void printBytecode(Bytecode *bytecode);
+
+#endif
@@ -0,0 +1,129 @@
+/* Value classes and storage
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+
+#include "classes.h"
+
+extern __thread SymTab *symtab;
+extern __thread Ast *ast;
+
+static __thread unsigned char *classes; // by NodeId: valueClass plus one, once known
+
+Object *objectOf(ObjectId id)
+{
+  return symtab->objects.objects[id];
+}
+
+int isIntClass(int typeClass)
+{
+  return (typeClass == TP_INT) || (typeClass == TP_CHAR);
+}
+
+int binaryClass(int leftClass, int rightClass)
+{
+  if ((leftClass == TP_STRING) || (rightClass == TP_STRING))
+    return TP_STRING;
+  if (rightClass == TP_DOUBLE)
+    return TP_DOUBLE;
+  return leftClass;
+}
+
+int comparisonClass(int class1, int class2)
+{
+  if ((class1 == TP_STRING) || (class2 == TP_STRING))
+    return TP_STRING;
+  if ((class1 == TP_DOUBLE) || (class2 == TP_DOUBLE))
+    return TP_DOUBLE;
+  return TP_INT;
+}
+
+void initValueClasses(void)
+{
+  classes = (unsigned char *)calloc(ast->count, sizeof(unsigned char));
+}
+
+void cleanValueClasses(void)
+{
+  free(classes);
+  classes = NULL;
+}
+
+int valueClass(NodeId id)
+{
+  Node *n = getNode(id);
+  int typeClass;
+
+  if (classes[id] != 0)
+    return classes[id] - 1;
+  switch (n->kind)
+  {
+  case N_BINARY:
+    typeClass = binaryClass(valueClass(n->child), valueClass(getNode(n->child)->sibling));
+    break;
+  case N_NEGATE:
+    typeClass = valueClass(n->child);
+    break;
+  default:
+    typeClass = n->typeClass;
+    break;
+  }
+  classes[id] = typeClass + 1;
+  return typeClass;
+}
+
+int sizeOfType(Type *type)
+{
+  return (type->typeClass == TP_ARRAY) ? type->arraySize * sizeOfType(type->elementType) : 1;
+}
+
+Scope *routineScope(Object *routine)
+{
+  switch (routine->kind)
+  {
+  case OBJ_FUNCTION:
+    return routine->funcAttrs->scope;
+  case OBJ_PROCEDURE:
+    return routine->procAttrs->scope;
+  default:
+    return routine->progAttrs->scope;
+  }
+}
+
+// Only the program's scope has no outer one
+static int scopeLevel(Scope *scope)
+{
+  int level = 0;
+
+  for (; scope->outer != NULL; scope = scope->outer)
+    level++;
+  return level;
+}
+
+int routineLevel(Object *routine)
+{
+  return scopeLevel(routineScope(routine));
+}
+
+int levelsOut(Object *obj, int level)
+{
+  return level - scopeLevel(symtab->objects.scopes[obj->id]);
+}
+
+int forNesting(NodeId statement)
+{
+  Node *n = getNode(statement);
+  NodeId child;
+  int nesting = 0, inner;
+
+  for (child = n->child; child != NO_NODE; child = getNode(child)->sibling)
+  {
+    inner = forNesting(child);
+    if (inner > nesting)
+      nesting = inner;
+  }
+  return (n->kind == N_FOR) ? nesting + 1 : nesting;
+}
@@ -0,0 +1,55 @@
+/* Value classes and storage
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CLASSES_H__
+#define __CLASSES_H__
+
+#include "ast.h"
+#include "symtab.h"
+
+/* What the code generators (codegen.h, asmgen.h) and the folder (fold.h)
+ * must agree on about the checked program: the class of the value each
+ * expression computes, which decides the conversions and the instructions
+ * used, and how deep each routine is nested. They all ask here, so kplvm's
+ * code, the native code and the folded values promote alike. */
+
+// The thread's symbol table object with the id
+Object *objectOf(ObjectId id);
+
+// Ints and chars are the same to both machines
+int isIntClass(int typeClass);
+
+/* The class an operator's value is of, given its operands': checking gives
+ * a chain of + or - the type of its first term, but the value is a string
+ * when strings are concatenated, and a double if the right operand is one,
+ * as the left one is converted. The exponent of ** is an int. */
+int binaryClass(int leftClass, int rightClass);
+
+// The class two values are compared as
+int comparisonClass(int class1, int class2);
+
+// Keeps the classes of the nodes of the thread's syntax tree as they are
+// asked for, until cleanValueClasses; the tree must not change meanwhile
+void initValueClasses(void);
+void cleanValueClasses(void);
+// The class of the value an expression computes
+int valueClass(NodeId id);
+
+// The cells, or words, a value of the type takes
+int sizeOfType(Type *type);
+
+// The scope a routine declares its parameters, variables and routines in
+Scope *routineScope(Object *routine);
+// How deep a routine is nested; the program's is 0
+int routineLevel(Object *routine);
+// How many frames out from a routine at level obj is declared
+int levelsOut(Object *obj, int level);
+
+// The most FOR loops open at once in a statement; each keeps its final
+// value in a cell of the routine's frame, evaluated once as it starts
+int forNesting(NodeId statement);
+
+#endif
@@ -0,0 +1,628 @@
+/* Code generation
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "codegen.h"
+#include "classes.h"
+#include "token.h"
+
+/* The generator walks the syntax tree once, routine by routine. A routine
+ * jumps over the code of the routines declared in it to its own body, so
+ * the program's code starts at 0 like any other routine's. Calls name the
+ * callee by ObjectId until every routine has an address, and are patched
+ * at the end. */
+
+extern __thread SymTab *symtab;
+extern __thread Ast *ast;
+
+static __thread Bytecode *code;
+static __thread int level;          // of the routine being compiled; the program's is 0
+static __thread int *cells;         // by ObjectId: a variable's cell
+static __thread int forCell;        // the cell the next FOR keeps its final value in
+static __thread int *entries;       // by ObjectId: a routine's address
+static __thread int *caseJumps;     // by NodeId: the jump to a CASE, plus one, in its SWITCH
+
+// The jumps out of the loops and SWITCHes being compiled, to be patched
+// as each one ends
+static __thread int *breaks;
+static __thread int breakCount;
+static __thread int breakCapacity;
+static __thread int breakables; // how many loops and SWITCHes are open
+
+// The innermost SWITCH's DEFAULT, and the jump to it
+static __thread NodeId defaultNode;
+static __thread int defaultJump;
+
+static void patch(int jump)
+{
+  code->code[jump].q = code->codeSize;
+}
+
+/******************************************************************/
+
+// Converts the value on top from one TypeClass to another
+static void genConversion(int from, int to)
+{
+  if ((from == to) || (isIntClass(from) && isIntClass(to)))
+    return;
+  if (to == TP_STRING)
+    emit(code, OP_CVS, 0, from);
+  else if (to == TP_DOUBLE)
+    emit(code, OP_CVD, 0, 0);
+  else if (from == TP_DOUBLE)
+    emit(code, OP_CVI, 0, 0);
+}
+
+// Compares the two values on top, both of typeClass
+static void genComparison(int typeClass, int op)
+{
+  if (typeClass == TP_DOUBLE)
+    emit(code, OP_CMPF, 0, 0);
+  else if (typeClass == TP_STRING)
+    emit(code, OP_CMPS, 0, 0);
+  if (!isIntClass(typeClass))
+    emit(code, OP_LC, 0, 0);
+
+  switch (op)
+  {
+  case SB_EQ:
+    emit(code, OP_EQ, 0, 0);
+    break;
+  case SB_NEQ:
+    emit(code, OP_NE, 0, 0);
+    break;
+  case SB_LT:
+    emit(code, OP_LT, 0, 0);
+    break;
+  case SB_LE:
+    emit(code, OP_LE, 0, 0);
+    break;
+  case SB_GT:
+    emit(code, OP_GT, 0, 0);
+    break;
+  default:
+    emit(code, OP_GE, 0, 0);
+    break;
+  }
+}
+
+static void genExpression(NodeId id);
+
+static void genValue(NodeId id, int typeClass)
+{
+  genExpression(id);
+  genConversion(valueClass(id), typeClass);
+}
+
+static void genConstant(ConstantId id)
+{
+  ConstantValue *value = constantValue(id);
+
+  if (value->type == TP_INT)
+    emit(code, OP_LC, 0, value->intValue);
+  else if (value->type == TP_CHAR)
+    emit(code, OP_LC, 0, (unsigned char)value->charValue);
+  else
+    emit(code, OP_LK, 0, id);
+}
+
+static void genVariableAddress(Object *var)
+{
+  // a function's result is only ever set inside the function itself
+  if (var->kind == OBJ_FUNCTION)
+    emit(code, OP_LA, 0, FRAME_RV);
+  else if ((var->kind == OBJ_PARAMETER) && (var->paramAttrs->kind == PARAM_REFERENCE))
+    emit(code, OP_LV, levelsOut(var, level), cells[var->id]);
+  else
+    emit(code, OP_LA, levelsOut(var, level), cells[var->id]);
+}
+
+static void genVariableValue(Object *var)
+{
+  emit(code, OP_LV, levelsOut(var, level), cells[var->id]);
+  if ((var->kind == OBJ_PARAMETER) && (var->paramAttrs->kind == PARAM_REFERENCE))
+    emit(code, OP_LI, 0, 0);
+}
+
+static void genElementAddress(NodeId id)
+{
+  Object *array = objectOf(getNode(id)->value);
+  Type *type = objectType(array);
+  NodeId index;
+  int size;
+
+  genVariableAddress(array);
+  for (index = getNode(id)->child; index != NO_NODE; index = getNode(index)->sibling)
+  {
+    genValue(index, TP_INT);
+    emit(code, OP_IX, 0, type->arraySize);
+    type = type->elementType;
+    size = sizeOfType(type);
+    if (size > 1)
+    {
+      emit(code, OP_LC, 0, size);
+      emit(code, OP_ML, 0, 0);
+    }
+    emit(code, OP_AD, 0, 0);
+  }
+}
+
+static void genAddress(NodeId id)
+{
+  if (getNode(id)->kind == N_INDEX)
+    genElementAddress(id);
+  else
+    genVariableAddress(objectOf(getNode(id)->value));
+}
+
+static void genCall(Object *callee, NodeId args)
+{
+  NodeId arg;
+  Object *param;
+  int i = 0;
+
+  switch (callee->id)
+  {
+  case READC_ID:
+    emit(code, OP_RC, 0, 0);
+    return;
+  case READI_ID:
+    emit(code, OP_RI, 0, 0);
+    return;
+  case WRITEI_ID:
+    genValue(args, TP_INT);
+    emit(code, OP_WRI, 0, 0);
+    return;
+  case WRITEC_ID:
+    genValue(args, TP_CHAR);
+    emit(code, OP_WRC, 0, 0);
+    return;
+  case WRITED_ID:
+    genValue(args, TP_DOUBLE);
+    emit(code, OP_WRD, 0, 0);
+    return;
+  case WRITES_ID:
+    genValue(args, TP_STRING);
+    emit(code, OP_WRS, 0, 0);
+    return;
+  case WRITELN_ID:
+    emit(code, OP_WLN, 0, 0);
+    return;
+  default:
+    break;
+  }
+
+  // parameters are basic types, so each argument takes one cell
+  emit(code, OP_INT, 0, FRAME_HEADER);
+  for (arg = args; arg != NO_NODE; arg = getNode(arg)->sibling)
+  {
+    param = getParam(callee, i++);
+    if (param->paramAttrs->kind == PARAM_REFERENCE)
+      genAddress(arg);
+    else
+      genValue(arg, objectType(param)->typeClass);
+  }
+  emit(code, OP_DCT, 0, FRAME_HEADER + i);
+  emit(code, OP_CALL, levelsOut(callee, level), callee->id);
+}
+
+static void genBinary(NodeId id)
+{
+  Node *n = getNode(id);
+  NodeId left = n->child;
+  NodeId right = getNode(left)->sibling;
+  int op = n->op;
+  int typeClass = valueClass(id);
+
+  if (typeClass == TP_STRING)
+  {
+    genValue(left, TP_STRING);
+    genValue(right, TP_STRING);
+    emit(code, OP_CAT, 0, 0);
+    return;
+  }
+
+  genValue(left, typeClass);
+  genValue(right, (op == SB_POWER) ? TP_INT : typeClass);
+  switch (op)
+  {
+  case SB_PLUS:
+    emit(code, (typeClass == TP_DOUBLE) ? OP_ADF : OP_AD, 0, 0);
+    break;
+  case SB_MINUS:
+    emit(code, (typeClass == TP_DOUBLE) ? OP_SBF : OP_SB, 0, 0);
+    break;
+  case SB_TIMES:
+    emit(code, (typeClass == TP_DOUBLE) ? OP_MLF : OP_ML, 0, 0);
+    break;
+  case SB_SLASH:
+    emit(code, (typeClass == TP_DOUBLE) ? OP_DVF : OP_DV, 0, 0);
+    break;
+  default:
+    emit(code, (typeClass == TP_DOUBLE) ? OP_PWF : OP_PW, 0, 0);
+    break;
+  }
+}
+
+static void genExpression(NodeId id)
+{
+  Node *n = getNode(id);
+  Object *obj;
+
+  switch (n->kind)
+  {
+  case N_NUMBER:
+  case N_CHAR:
+    emit(code, OP_LC, 0, n->value);
+    break;
+  case N_LITERAL:
+    emit(code, OP_LK, 0, n->value);
+    break;
+  case N_CONSTANT:
+    genConstant(objectOf(n->value)->constAttrs->value);
+    break;
+  case N_VARIABLE:
+    genVariableValue(objectOf(n->value));
+    break;
+  case N_INDEX:
+    genElementAddress(id);
+    emit(code, OP_LI, 0, 0);
+    break;
+  case N_FUNCALL:
+    obj = objectOf(n->value);
+    genCall(obj, n->child);
+    break;
+  case N_NEGATE:
+    genExpression(n->child);
+    emit(code, (valueClass(n->child) == TP_DOUBLE) ? OP_NEGF : OP_NEG, 0, 0);
+    break;
+  case N_BINARY:
+    genBinary(id);
+    break;
+  default:
+    break;
+  }
+}
+
+// Pushes 1 if the condition holds, else 0
+static void genCondition(NodeId id)
+{
+  NodeId left = getNode(id)->child;
+  NodeId right = getNode(left)->sibling;
+  int typeClass = comparisonClass(valueClass(left), valueClass(right));
+
+  genValue(left, typeClass);
+  genValue(right, typeClass);
+  genComparison(typeClass, getNode(id)->op);
+}
+
+/******************************************************************/
+
+static void genStatement(NodeId id);
+
+static void addBreak(int jump)
+{
+  if (breakCount == breakCapacity)
+  {
+    breakCapacity = (breakCapacity == 0) ? 16 : breakCapacity * 2;
+    breaks = (int *)realloc(breaks, breakCapacity * sizeof(int));
+  }
+  breaks[breakCount++] = jump;
+}
+
+// Sends the BREAKs since the loop or SWITCH began, at first, to here
+static void patchBreaks(int first)
+{
+  while (breakCount > first)
+    patch(breaks[--breakCount]);
+}
+
+/* The final value is evaluated once, before the first pass. The variable
+ * is compared with it before it is stepped, so that a loop up to the
+ * largest int ends; an int that is less can be stepped and stays within
+ * it, but a double must be tested again. */
+static void genFor(NodeId id)
+{
+  Object *var = objectOf(getNode(id)->value);
+  int typeClass = objectType(var)->typeClass;
+  int compareClass = comparisonClass(typeClass, typeClass);
+  NodeId from = getNode(id)->child;
+  NodeId to = getNode(from)->sibling;
+  int firstBreak = breakCount;
+  int limit = forCell++;
+  int test, body, exit, last;
+
+  genVariableAddress(var);
+  genValue(from, typeClass);
+  emit(code, OP_ST, 0, 0);
+  emit(code, OP_LA, 0, limit);
+  genValue(to, typeClass);
+  emit(code, OP_ST, 0, 0);
+
+  test = code->codeSize;
+  genVariableValue(var);
+  emit(code, OP_LV, 0, limit);
+  genComparison(compareClass, SB_LE);
+  exit = emit(code, OP_FJ, 0, 0);
+
+  body = code->codeSize;
+  breakables++;
+  genStatement(getNode(to)->sibling);
+  breakables--;
+
+  genVariableValue(var);
+  emit(code, OP_LV, 0, limit);
+  genComparison(compareClass, SB_LT);
+  last = emit(code, OP_FJ, 0, 0);
+  genVariableAddress(var);
+  genVariableValue(var);
+  emit(code, OP_LC, 0, 1);
+  if (typeClass == TP_DOUBLE)
+  {
+    emit(code, OP_CVD, 0, 0);
+    emit(code, OP_ADF, 0, 0);
+  }
+  else
+    emit(code, OP_AD, 0, 0);
+  emit(code, OP_ST, 0, 0);
+  emit(code, OP_J, 0, (typeClass == TP_DOUBLE) ? test : body);
+  patch(exit);
+  patch(last);
+  patchBreaks(firstBreak);
+  forCell--;
+}
+
+// Adds a test for each CASE in the SWITCH's statement, and not in a SWITCH
+// nested in it, and finds its first DEFAULT
+static void genCaseTests(NodeId id, int valueClassOfSwitch, NodeId *firstDefault)
+{
+  Node *n = getNode(id);
+  ConstantValue *value;
+  int typeClass;
+  NodeId child;
+
+  switch (n->kind)
+  {
+  case N_SWITCH:
+    return;
+  case N_CASE:
+    value = constantValue(n->value);
+    // a string never equals a number
+    if ((value->type == TP_STRING) == (valueClassOfSwitch == TP_STRING))
+    {
+      typeClass = comparisonClass(value->type, valueClassOfSwitch);
+      emit(code, OP_CP, 0, 0);
+      genConversion(valueClassOfSwitch, typeClass);
+      genConstant(n->value);
+      genConversion(value->type, typeClass);
+      genComparison(typeClass, SB_NEQ);
+      caseJumps[id] = emit(code, OP_FJ, 0, 0) + 1;
+    }
+    break;
+  case N_DEFAULT:
+    if (*firstDefault == NO_NODE)
+      *firstDefault = id;
+    break;
+  default:
+    break;
+  }
+  for (child = n->child; child != NO_NODE; child = getNode(child)->sibling)
+    genCaseTests(child, valueClassOfSwitch, firstDefault);
+}
+
+// The value switched on stays on the stack while the statement runs
+static void genSwitch(NodeId id)
+{
+  NodeId exp = getNode(id)->child;
+  NodeId savedDefault = defaultNode;
+  int savedJump = defaultJump;
+  int firstBreak = breakCount;
+
+  genExpression(exp);
+  defaultNode = NO_NODE;
+  genCaseTests(getNode(exp)->sibling, valueClass(exp), &defaultNode);
+  defaultJump = emit(code, OP_J, 0, 0);
+
+  breakables++;
+  genStatement(getNode(exp)->sibling);
+  breakables--;
+  if (defaultNode == NO_NODE)
+    patch(defaultJump);
+  patchBreaks(firstBreak);
+  emit(code, OP_DCT, 0, 1);
+
+  defaultNode = savedDefault;
+  defaultJump = savedJump;
+}
+
+static void genStatements(NodeId first)
+{
+  NodeId statement;
+
+  for (statement = first; statement != NO_NODE; statement = getNode(statement)->sibling)
+    genStatement(statement);
+}
+
+static void genStatement(NodeId id)
+{
+  Node *n = getNode(id);
+  NodeId child = n->child;
+  int jump, loop, firstBreak;
+
+  switch (n->kind)
+  {
+  case N_ASSIGN:
+    genAddress(child);
+    genValue(getNode(child)->sibling, getNode(child)->typeClass);
+    emit(code, OP_ST, 0, 0);
+    break;
+  case N_CALL:
+    genCall(objectOf(n->value), child);
+    break;
+  case N_GROUP:
+    genStatements(child);
+    break;
+  case N_IF:
+    genCondition(child);
+    jump = emit(code, OP_FJ, 0, 0);
+    child = getNode(child)->sibling;
+    genStatement(child);
+    if (getNode(child)->sibling != NO_NODE)
+    {
+      loop = emit(code, OP_J, 0, 0);
+      patch(jump);
+      genStatement(getNode(child)->sibling);
+      jump = loop;
+    }
+    patch(jump);
+    break;
+  case N_WHILE:
+    loop = code->codeSize;
+    genCondition(child);
+    jump = emit(code, OP_FJ, 0, 0);
+    firstBreak = breakCount;
+    breakables++;
+    genStatement(getNode(child)->sibling);
+    breakables--;
+    emit(code, OP_J, 0, loop);
+    patch(jump);
+    patchBreaks(firstBreak);
+    break;
+  case N_FOR:
+    genFor(id);
+    break;
+  case N_SWITCH:
+    genSwitch(id);
+    break;
+  case N_CASE:
+    if (caseJumps[id] != 0)
+      patch(caseJumps[id] - 1);
+    genStatements(child);
+    break;
+  case N_DEFAULT:
+    if (id == defaultNode)
+      patch(defaultJump);
+    genStatement(child);
+    break;
+  case N_BREAK:
+    // a BREAK outside any loop or SWITCH does nothing
+    if (breakables > 0)
+      addBreak(emit(code, OP_J, 0, 0));
+    break;
+  default:
+    break;
+  }
+}
+
+/******************************************************************/
+
+// Gives the routine's parameters and variables their cells; returns the
+// size of its frame
+static int layoutFrame(Object *routine)
+{
+  Scope *scope = routineScope(routine);
+  int size = FRAME_HEADER;
+  Object *obj;
+  int i;
+
+  for (i = 0; i < scope->objectCount; i++)
+  {
+    obj = scopeObject(scope, i);
+    switch (obj->kind)
+    {
+    case OBJ_VARIABLE:
+    case OBJ_PARAMETER:
+      cells[obj->id] = size;
+      size += sizeOfType(objectType(obj));
+      break;
+    default:
+      break;
+    }
+  }
+  return size;
+}
+
+static void genRoutine(NodeId id)
+{
+  Object *routine = objectOf(getNode(id)->value);
+  NodeId child = getNode(id)->child;
+  int savedLevel = level;
+  int frameSize, jump = -1;
+
+  level = routineLevel(routine);
+  frameSize = layoutFrame(routine);
+
+  if (getNode(child)->kind == N_ROUTINE)
+    jump = emit(code, OP_J, 0, 0);
+  for (; getNode(child)->kind == N_ROUTINE; child = getNode(child)->sibling)
+    genRoutine(child);
+  if (jump >= 0)
+    patch(jump);
+
+  // the FOR loops' final values take the cells after the variables
+  forCell = frameSize;
+  frameSize += forNesting(child);
+  entries[routine->id] = emit(code, OP_INT, (routine->kind == OBJ_PROGRAM) ? 0 : FRAME_HEADER + countParams(routine), frameSize);
+  genStatement(child);
+  if (routine->kind == OBJ_FUNCTION)
+    emit(code, OP_EF, 0, 0);
+  else if (routine->kind == OBJ_PROCEDURE)
+    emit(code, OP_EP, 0, 0);
+  else
+    emit(code, OP_HL, 0, 0);
+  level = savedLevel;
+}
+
+static void copyPool(void)
+{
+  ConstantPool *constants = &symtab->constants;
+  ConstantValue *value;
+  int i;
+
+  code->pool = (PooledValue *)calloc(constants->count + 1, sizeof(PooledValue));
+  code->poolSize = constants->count;
+  for (i = 0; i < constants->count; i++)
+  {
+    value = &constants->values[i];
+    if (value->type == TP_STRING)
+    {
+      code->pool[i].isString = 1;
+      code->pool[i].stringValue = strdup(value->stringValue);
+    }
+    else if (value->type == TP_DOUBLE)
+      code->pool[i].doubleValue = value->doubleValue;
+  }
+}
+
+void generateCode(Bytecode *bytecode)
+{
+  int i;
+
+  code = bytecode;
+  level = 0;
+  cells = (int *)calloc(symtab->objects.count, sizeof(int));
+  entries = (int *)calloc(symtab->objects.count, sizeof(int));
+  initValueClasses();
+  caseJumps = (int *)calloc(ast->count, sizeof(int));
+  breaks = NULL;
+  breakCount = breakCapacity = breakables = 0;
+  defaultNode = NO_NODE;
+
+  genRoutine(ast->root);
+  for (i = 0; i < code->codeSize; i++)
+    if (code->code[i].op == OP_CALL)
+      code->code[i].q = entries[code->code[i].q];
+  copyPool();
+
+  free(cells);
+  free(entries);
+  cleanValueClasses();
+  free(caseJumps);
+  free(breaks);
+  code = NULL;
+}
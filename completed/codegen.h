@@ -0,0 +1,18 @@
+/* Code generation
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CODEGEN_H__
+#define __CODEGEN_H__
+
+#include "ast.h"
+#include "symtab.h"
+#include "bytecode.h"
+
+// Compiles the checked program in the thread's syntax tree and symbol
+// table into bytecode, which the caller frees
+void generateCode(Bytecode *bytecode);
+
+#endif
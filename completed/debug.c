@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include "debug.h"
+#include "intern.h"
 
 void pad(int n)
 {
@@ -60,17 +61,17 @@ void printObject(Object *obj, int indent)
   case OBJ_CONSTANT:
     pad(indent);
     printf("Const %s = ", obj->name);
-    printConstantValue(obj->constAttrs->value);
+    printConstantValue(constantValue(obj->constAttrs->value));
     break;
   case OBJ_TYPE:
     pad(indent);
     printf("Type %s = ", obj->name);
-    printType(obj->typeAttrs->actualType);
+    printType(objectType(obj));
     break;
   case OBJ_VARIABLE:
     pad(indent);
     printf("Var %s : ", obj->name);
-    printType(obj->varAttrs->type);
+    printType(objectType(obj));
     break;
   case OBJ_PARAMETER:
     pad(indent);
@@ -78,12 +79,12 @@ void printObject(Object *obj, int indent)
       printf("Param %s : ", obj->name);
     else
       printf("Param VAR %s : ", obj->name);
-    printType(obj->paramAttrs->type);
+    printType(objectType(obj));
     break;
   case OBJ_FUNCTION:
     pad(indent);
     printf("Function %s : ", obj->name);
-    printType(obj->funcAttrs->returnType);
+    printType(objectType(obj));
     printf("\n");
     printScope(obj->funcAttrs->scope, indent + 4);
     break;
@@ -100,18 +101,89 @@ void printObject(Object *obj, int indent)
   }
 }
 
-void printObjectList(ObjectNode *objList, int indent)
+void printScope(Scope *scope, int indent)
 {
-  ObjectNode *node = objList;
-  while (node != NULL)
+  int i;
+
+  for (i = 0; i < scope->objectCount; i++)
   {
-    printObject(node->object, indent);
+    printObject(scopeObject(scope, i), indent);
     printf("\n");
-    node = node->next;
   }
 }
 
-void printScope(Scope *scope, int indent)
+/******************************************************************/
+
+static const char *kindNames[] = {"constant", "variable", "type", "function", "procedure", "parameter", "program"};
+static const char *categoryNames[] = {"objects", "scopes", "lists", "types", "constants", "bindings"};
+
+void printSymTabStats(SymTab *symtab, enum StatsFormat format)
 {
-  printObjectList(scope->objList, indent);
+  SymTabStats *stats = &symtab->stats;
+  double steps = (stats->lookups > 0) ? (double)stats->lookupSteps / stats->lookups : 0.0;
+  size_t tables = symtab->displaySize * sizeof(DisplayEntry) + symtab->arrayTypesSize * sizeof(Type *) +
+                  symtab->objects.capacity * (sizeof(Object *) + sizeof(unsigned char) + sizeof(const char *) +
+                                              sizeof(Type *) + sizeof(Scope *)) +
+                  symtab->constants.capacity * sizeof(ConstantValue) + symtab->constants.slotCount * sizeof(ConstantId);
+  int i;
+
+  if (format == STATS_JSON)
+  {
+    fprintf(stderr, "{\"objects\": {");
+    for (i = 0; i <= OBJ_PROGRAM; i++)
+      fprintf(stderr, "%s\"%s\": %ld", (i > 0) ? ", " : "", kindNames[i], stats->objects[i]);
+    fprintf(stderr, "}, \"scopes\": %ld, \"maxDepth\": %d, ", stats->scopes, stats->maxDepth);
+    fprintf(stderr, "\"lookups\": %ld, \"stepsPerLookup\": %.3f, \"builtinLookups\": %ld, \"freshChecks\": %ld, ",
+            stats->lookups, steps, stats->builtinLookups, stats->freshChecks);
+    fprintf(stderr, "\"constants\": %ld, \"pooledConstants\": %d, ", stats->constants, symtab->constants.count);
+    fprintf(stderr, "\"names\": %d, \"bytes\": {", countNames());
+    for (i = 0; i < NUM_OF_ALLOC_CATEGORIES; i++)
+      fprintf(stderr, "\"%s\": %zu, ", categoryNames[i], stats->bytes[i]);
+    fprintf(stderr, "\"tables\": %zu, \"names\": %zu}}\n", tables, namesMemory());
+    return;
+  }
+
+  fprintf(stderr, "objects       ");
+  for (i = 0; i <= OBJ_PROGRAM; i++)
+    fprintf(stderr, " %s %ld", kindNames[i], stats->objects[i]);
+  fprintf(stderr, "\nscopes         %ld, nested %d deep at most\n", stats->scopes, stats->maxDepth);
+  fprintf(stderr, "lookups        %ld, %.3f steps each, %ld ended in the built-ins\n",
+          stats->lookups, steps, stats->builtinLookups);
+  fprintf(stderr, "fresh checks   %ld\n", stats->freshChecks);
+  fprintf(stderr, "constants      %ld, %d once pooled\n", stats->constants, symtab->constants.count);
+  fprintf(stderr, "names          %d\n", countNames());
+  fprintf(stderr, "bytes         ");
+  for (i = 0; i < NUM_OF_ALLOC_CATEGORIES; i++)
+    fprintf(stderr, " %s %zu", categoryNames[i], stats->bytes[i]);
+  fprintf(stderr, " tables %zu names %zu\n", tables, namesMemory());
+}
+
+static const char *nodeKindNames[] = {"routine", "group", "assign", "call", "if", "while", "for", "switch",
+                                      "case", "default", "break", "empty", "compare", "binary", "negate",
+                                      "number", "char", "literal", "constant", "variable", "index", "funcall"};
+
+void printAstStats(Ast *ast, enum StatsFormat format)
+{
+  long counts[NUM_OF_NODE_KINDS] = {0};
+  int nodes = ast->count - 1; // not node 0
+  int i;
+
+  for (i = 1; i < ast->count; i++)
+    counts[ast->nodes[i].kind]++;
+
+  if (format == STATS_JSON)
+  {
+    fprintf(stderr, "{\"nodes\": %d, \"bytesPerNode\": %zu, \"bytes\": %zu, \"kinds\": {",
+            nodes, sizeof(Node), astMemory());
+    for (i = 0; i < NUM_OF_NODE_KINDS; i++)
+      fprintf(stderr, "%s\"%s\": %ld", (i > 0) ? ", " : "", nodeKindNames[i], counts[i]);
+    fprintf(stderr, "}}\n");
+    return;
+  }
+
+  fprintf(stderr, "nodes          %d, %zu bytes each, %zu bytes in all\n", nodes, sizeof(Node), astMemory());
+  fprintf(stderr, "node kinds    ");
+  for (i = 0; i < NUM_OF_NODE_KINDS; i++)
+    fprintf(stderr, " %s %ld", nodeKindNames[i], counts[i]);
+  fprintf(stderr, "\n");
 }
@@ -8,11 +8,23 @@
 #define __DEBUG_H_
 
 #include "symtab.h"
+#include "ast.h"
 
 void printType(Type* type);
 void printConstantValue(ConstantValue* value);
 void printObject(Object* obj, int indent);
-void printObjectList(ObjectNode* objList, int indent);
 void printScope(Scope* scope, int indent);
 
+enum StatsFormat
+{
+  STATS_NONE,
+  STATS_TEXT,
+  STATS_JSON
+};
+
+// Prints the symbol table's counters (see SymTabStats) to stderr
+void printSymTabStats(SymTab* symtab, enum StatsFormat format);
+// Prints the syntax tree's node counts and size, on a line of its own
+void printAstStats(Ast* ast, enum StatsFormat format);
+
 #endif
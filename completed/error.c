@@ -8,14 +8,14 @@
 #include <stdlib.h>
 #include "error.h"
 
-#define NUM_OF_ERRORS 29
+#define NUM_OF_ERRORS 31
 
 struct ErrorMessage {
   ErrorCode errorCode;
   char *message;
 };
 
-struct ErrorMessage errors[29] = {
+struct ErrorMessage errors[NUM_OF_ERRORS] = {
   {ERR_END_OF_COMMENT, "End of comment expected."},
   {ERR_IDENT_TOO_LONG, "Identifier too long."},
   {ERR_INVALID_CONSTANT_CHAR, "Invalid char constant."},
@@ -44,21 +44,31 @@ struct ErrorMessage errors[29] = {
   {ERR_UNDECLARED_PROCEDURE, "Undeclared procedure."},
   {ERR_DUPLICATE_IDENT, "Duplicate identifier."},
   {ERR_TYPE_INCONSISTENCY, "Type inconsistency"},
-  {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."}
+  {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."},
+  {ERR_CONSTANT_TOO_LONG, "Constant too long."},
+  {ERR_READ_FAILED, "The rest of the input cannot be read."}
 };
 
+__thread jmp_buf *errorTrap = NULL;
+
+static void stop(void) {
+  if (errorTrap != NULL)
+    longjmp(*errorTrap, 1);
+  exit(0);
+}
+
 void error(ErrorCode err, int lineNo, int colNo) {
   int i;
   for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
     if (errors[i].errorCode == err) {
       printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
-      exit(0);
+      stop();
     }
 }
 
 void missingToken(TokenType tokenType, int lineNo, int colNo) {
   printf("%d-%d:Missing %s\n", lineNo, colNo, tokenToString(tokenType));
-  exit(0);
+  stop();
 }
 
 void assert(char *msg) {
@@ -6,6 +6,7 @@
 
 #ifndef __ERROR_H__
 #define __ERROR_H__
+#include <setjmp.h>
 #include "token.h"
 
 typedef enum {
@@ -37,9 +38,15 @@ typedef enum {
   ERR_UNDECLARED_PROCEDURE,
   ERR_DUPLICATE_IDENT,
   ERR_TYPE_INCONSISTENCY,
-  ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY
+  ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY,
+  ERR_CONSTANT_TOO_LONG,
+  ERR_READ_FAILED
 } ErrorCode;
 
+// While a compilation runs, errors jump back to it instead of ending the
+// process, so other compilations in the same process carry on.
+extern __thread jmp_buf *errorTrap;
+
 void error(ErrorCode err, int lineNo, int colNo);
 void missingToken(TokenType tokenType, int lineNo, int colNo);
 void assert(char *msg);
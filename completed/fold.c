@@ -0,0 +1,222 @@
+/* Constant folding
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <limits.h>
+#include <math.h>
+
+#include "fold.h"
+#include "classes.h"
+#include "power.h"
+#include "token.h"
+
+/* The folder walks the whole tree once, children before their parent, so
+ * a chain such as N * 4 + 1 folds from its innermost operator out. A node
+ * is rewritten where it is, keeping its sibling, into an N_NUMBER, N_CHAR
+ * or N_LITERAL of the class valueClass (classes.h) gives it, which is what
+ * the generators load for it.
+ *
+ * A folded value is the one the program would compute: ints wrap, doubles
+ * promote as at run time, and ** is the machine's own (power.h). What
+ * would stop the program is left for it to report: a division by zero,
+ * INT_MIN / -1, and doubles that come out infinite or not a number, which
+ * have no literal to write them as. */
+
+extern __thread Ast *ast;
+
+// The value of a node that needs nothing from the running program
+typedef struct
+{
+  int typeClass; // TP_INT, TP_CHAR or TP_DOUBLE
+  int intValue;
+  double doubleValue;
+} Value;
+
+// Whether the node is a number, character or double, and which
+static int valueOf(NodeId id, Value *value)
+{
+  Node *n = getNode(id);
+  ConstantValue *constant;
+
+  switch (n->kind)
+  {
+  case N_NUMBER:
+  case N_CHAR:
+    value->typeClass = n->typeClass;
+    value->intValue = n->value;
+    return 1;
+  case N_LITERAL:
+    constant = constantValue(n->value);
+    if (constant->type != TP_DOUBLE)
+      return 0;
+    value->typeClass = TP_DOUBLE;
+    value->doubleValue = constant->doubleValue;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static void makeValue(NodeId id, Value *value)
+{
+  Node *n = getNode(id);
+
+  n->child = NO_NODE;
+  n->op = 0;
+  n->typeClass = value->typeClass;
+  if (value->typeClass == TP_DOUBLE)
+  {
+    n->kind = N_LITERAL;
+    n->value = makeDoubleConstant(value->doubleValue);
+  }
+  else
+  {
+    n->kind = (value->typeClass == TP_CHAR) ? N_CHAR : N_NUMBER;
+    n->value = value->intValue;
+  }
+}
+
+// A declared constant becomes its value; strings are pooled already
+static void foldConstant(NodeId id)
+{
+  Node *n = getNode(id);
+  ConstantId valueId = objectOf(n->value)->constAttrs->value;
+  ConstantValue *constant = constantValue(valueId);
+
+  switch (constant->type)
+  {
+  case TP_INT:
+    n->kind = N_NUMBER;
+    n->value = constant->intValue;
+    break;
+  case TP_CHAR:
+    n->kind = N_CHAR;
+    n->value = (unsigned char)constant->charValue;
+    break;
+  default:
+    n->kind = N_LITERAL;
+    n->value = valueId;
+    break;
+  }
+  n->typeClass = constant->type;
+}
+
+static int foldInt(int op, int left, int right, int *result)
+{
+  switch (op)
+  {
+  case SB_PLUS:
+    *result = (int)((unsigned int)left + (unsigned int)right);
+    return 1;
+  case SB_MINUS:
+    *result = (int)((unsigned int)left - (unsigned int)right);
+    return 1;
+  case SB_TIMES:
+    *result = (int)((unsigned int)left * (unsigned int)right);
+    return 1;
+  case SB_SLASH:
+    if ((right == 0) || ((right == -1) && (left == INT_MIN)))
+      return 0;
+    *result = left / right;
+    return 1;
+  default:
+    *result = intPower(left, right);
+    return 1;
+  }
+}
+
+static int foldDouble(int op, double left, Value *right, double *result)
+{
+  switch (op)
+  {
+  case SB_PLUS:
+    *result = left + right->doubleValue;
+    break;
+  case SB_MINUS:
+    *result = left - right->doubleValue;
+    break;
+  case SB_TIMES:
+    *result = left * right->doubleValue;
+    break;
+  case SB_SLASH:
+    *result = left / right->doubleValue;
+    break;
+  default:
+    *result = pow(left, right->intValue);
+    break;
+  }
+  return isfinite(*result);
+}
+
+// The operands are converted as the generators convert them (binaryClass)
+static void foldBinary(NodeId id)
+{
+  NodeId leftId = getNode(id)->child;
+  int op = getNode(id)->op;
+  Value left, right, result;
+
+  if (!valueOf(leftId, &left) || !valueOf(getNode(leftId)->sibling, &right))
+    return;
+  // the exponent of ** stays an int
+  if ((op == SB_POWER) && (right.typeClass == TP_DOUBLE))
+    return;
+
+  result.typeClass = binaryClass(left.typeClass, right.typeClass);
+  if ((result.typeClass == TP_DOUBLE) && (right.typeClass != TP_DOUBLE))
+    right.doubleValue = right.intValue;
+  if ((result.typeClass == TP_DOUBLE) && (left.typeClass != TP_DOUBLE))
+    left.doubleValue = left.intValue;
+
+  if (result.typeClass == TP_DOUBLE)
+  {
+    if (!foldDouble(op, left.doubleValue, &right, &result.doubleValue))
+      return;
+  }
+  else if (!foldInt(op, left.intValue, right.intValue, &result.intValue))
+    return;
+  makeValue(id, &result);
+}
+
+static void foldNegate(NodeId id)
+{
+  Value value;
+
+  if (!valueOf(getNode(id)->child, &value))
+    return;
+  if (value.typeClass == TP_DOUBLE)
+    value.doubleValue = -value.doubleValue;
+  else
+    value.intValue = (int)(0u - (unsigned int)value.intValue);
+  makeValue(id, &value);
+}
+
+static void foldNode(NodeId id)
+{
+  NodeId child;
+
+  for (child = getNode(id)->child; child != NO_NODE; child = getNode(child)->sibling)
+    foldNode(child);
+
+  switch (getNode(id)->kind)
+  {
+  case N_CONSTANT:
+    foldConstant(id);
+    break;
+  case N_BINARY:
+    foldBinary(id);
+    break;
+  case N_NEGATE:
+    foldNegate(id);
+    break;
+  default:
+    break;
+  }
+}
+
+void foldConstants(void)
+{
+  if (ast->root != NO_NODE)
+    foldNode(ast->root);
+}
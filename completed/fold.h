@@ -0,0 +1,20 @@
+/* Constant folding
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __FOLD_H__
+#define __FOLD_H__
+
+#include "ast.h"
+#include "symtab.h"
+
+/* Rewrites the expressions of the checked program in the thread's syntax
+ * tree that need nothing from the running program: each use of a declared
+ * constant becomes its value, and + - * / ** and unary minus over values
+ * become the value they compute. The code generators then load one value
+ * where they would have computed it. */
+void foldConstants(void);
+
+#endif
@@ -0,0 +1,124 @@
+/* Identifier interning
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "arena.h"
+#include "intern.h"
+
+/* The names themselves are packed one after another into an arena, so
+ * interning costs no allocation of its own and freeing them all is a walk
+ * over a few blocks. The set of names is an open-addressing table with
+ * linear probing, kept at most half full, that remembers each name's hash
+ * and length so that a probe rarely has to look at the characters. */
+
+#define INITIAL_TABLE_SIZE 256
+
+typedef struct
+{
+  const char *name; // NULL for a free slot
+  unsigned hash;
+  int length;
+} NameEntry;
+
+// Names are per thread, like the rest of a compilation's state
+static __thread Arena nameArena;
+static __thread NameEntry *table;
+static __thread int tableSize;
+static __thread int nameCount;
+
+static unsigned hashText(const char *text, int length)
+{
+  unsigned hash = 2166136261u;
+  int i;
+
+  for (i = 0; i < length; i++)
+    hash = (hash ^ (unsigned char)toupper((unsigned char)text[i])) * 16777619u;
+  return hash;
+}
+
+static int sameName(const char *name, const char *text, int length)
+{
+  int i;
+
+  for (i = 0; i < length; i++)
+    if (name[i] != toupper((unsigned char)text[i]))
+      return 0;
+  return 1;
+}
+
+static char *storeName(const char *text, int length)
+{
+  char *name = arenaAllocChars(&nameArena, length + 1);
+  int i;
+
+  for (i = 0; i < length; i++)
+    name[i] = toupper((unsigned char)text[i]);
+  name[length] = '\0';
+  return name;
+}
+
+static void growTable(void)
+{
+  int size = (tableSize == 0) ? INITIAL_TABLE_SIZE : tableSize * 2;
+  NameEntry *newTable = (NameEntry *)calloc(size, sizeof(NameEntry));
+  int i;
+
+  for (i = 0; i < tableSize; i++)
+    if (table[i].name != NULL)
+    {
+      unsigned j = table[i].hash & (size - 1);
+      while (newTable[j].name != NULL)
+        j = (j + 1) & (size - 1);
+      newTable[j] = table[i];
+    }
+  free(table);
+  table = newTable;
+  tableSize = size;
+}
+
+const char *internName(const char *text, int length)
+{
+  unsigned hash = hashText(text, length);
+  unsigned i;
+
+  if (2 * (nameCount + 1) > tableSize)
+    growTable();
+
+  i = hash & (tableSize - 1);
+  while (table[i].name != NULL)
+  {
+    if ((table[i].hash == hash) && (table[i].length == length) && sameName(table[i].name, text, length))
+      return table[i].name;
+    i = (i + 1) & (tableSize - 1);
+  }
+
+  table[i].name = storeName(text, length);
+  table[i].hash = hash;
+  table[i].length = length;
+  nameCount++;
+  return table[i].name;
+}
+
+void freeNames(void)
+{
+  freeArena(&nameArena);
+  free(table);
+  table = NULL;
+  tableSize = 0;
+  nameCount = 0;
+}
+
+int countNames(void)
+{
+  return nameCount;
+}
+
+size_t namesMemory(void)
+{
+  return tableSize * sizeof(NameEntry) + nameArena.used;
+}
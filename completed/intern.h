@@ -0,0 +1,27 @@
+/* Identifier interning
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+#include <stddef.h>
+
+/* Every distinct identifier is stored once, upper-cased, and handed out as
+ * a pointer to that copy. Two names are the same identifier exactly when
+ * their interned pointers are equal, so the symbol table compares and
+ * hashes pointers instead of strings. The names belong to the compilation
+ * running on the calling thread and stay valid until freeNames. */
+
+// Interns the identifier text[0..length), folding it to upper case.
+const char *internName(const char *text, int length);
+// Releases every name interned on this thread.
+void freeNames(void);
+
+// Number of distinct names, and the bytes they and the table take
+int countNames(void);
+size_t namesMemory(void);
+
+#endif
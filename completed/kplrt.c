@@ -0,0 +1,146 @@
+/* Runtime of native programs
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/resource.h>
+
+#include "symtab.h"
+#include "kplrt.h"
+#include "power.h"
+
+// As kplvm words them
+static const char *runtimeErrors[] = {
+    "Index out of range.",
+    "Division by zero.",
+    "Result out of the range of int.",
+    "Stack overflow."};
+
+// Room left for the runtime, and for kpl_error, below the last frame
+#define STACK_MARGIN (64 * 1024)
+// The stack assumed when it has no limit, and the most that is used
+#define DEFAULT_STACK_SIZE (64 * 1024 * 1024)
+#define MAX_STACK_SIZE (1024 * 1024 * 1024)
+
+char *kpl_stack_limit;
+
+static double toDouble(int64_t bits)
+{
+  double d;
+
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+void kpl_error(int err)
+{
+  fflush(stdout);
+  fprintf(stderr, "%s\n", runtimeErrors[err]);
+  exit(2);
+}
+
+void kpl_init(void)
+{
+  struct rlimit limit;
+  char top;
+  size_t size = DEFAULT_STACK_SIZE;
+
+  if ((getrlimit(RLIMIT_STACK, &limit) == 0) && (limit.rlim_cur != RLIM_INFINITY))
+    size = limit.rlim_cur;
+  if (size > MAX_STACK_SIZE)
+    size = MAX_STACK_SIZE;
+  // the environment and the frames below main take some of it already
+  kpl_stack_limit = (char *)((uintptr_t)&top - size + 2 * STACK_MARGIN);
+}
+
+int kpl_readc(void)
+{
+  return getchar();
+}
+
+int kpl_readi(void)
+{
+  int value;
+
+  if (scanf("%d", &value) != 1)
+    value = 0;
+  return value;
+}
+
+void kpl_writec(int64_t c)
+{
+  putchar((int)c);
+}
+
+void kpl_writei(int64_t i)
+{
+  printf("%d", (int)i);
+}
+
+void kpl_writed(int64_t bits)
+{
+  printf("%g", toDouble(bits));
+}
+
+void kpl_writes(const char *s)
+{
+  if (s != NULL)
+    fputs(s, stdout);
+}
+
+void kpl_writeln(void)
+{
+  putchar('\n');
+}
+
+int kpl_power(int base, int exponent)
+{
+  return intPower(base, exponent);
+}
+
+int64_t kpl_power_double(int64_t bits, int exponent)
+{
+  double d = pow(toDouble(bits), exponent);
+
+  memcpy(&bits, &d, sizeof(d));
+  return bits;
+}
+
+char *kpl_concat(const char *s1, const char *s2)
+{
+  size_t length1 = (s1 == NULL) ? 0 : strlen(s1);
+  size_t length2 = (s2 == NULL) ? 0 : strlen(s2);
+  char *s = (char *)malloc(length1 + length2 + 1);
+
+  if (length1 > 0)
+    memcpy(s, s1, length1);
+  if (length2 > 0)
+    memcpy(s + length1, s2, length2);
+  s[length1 + length2] = '\0';
+  return s;
+}
+
+int kpl_compare(const char *s1, const char *s2)
+{
+  int c = strcmp((s1 == NULL) ? "" : s1, (s2 == NULL) ? "" : s2);
+
+  return (c < 0) ? -1 : (c > 0);
+}
+
+char *kpl_to_string(int64_t value, int typeClass)
+{
+  char buffer[32];
+
+  if (typeClass == TP_DOUBLE)
+    snprintf(buffer, sizeof(buffer), "%g", toDouble(value));
+  else if (typeClass == TP_CHAR)
+    snprintf(buffer, sizeof(buffer), "%c", (int)value);
+  else
+    snprintf(buffer, sizeof(buffer), "%d", (int)value);
+  return strdup(buffer);
+}
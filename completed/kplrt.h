@@ -0,0 +1,49 @@
+/* Runtime of native programs
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __KPLRT_H__
+#define __KPLRT_H__
+
+#include <stdint.h>
+
+/* The code kplc -S writes (asmgen.h) calls these for what it does not do
+ * inline. Every value is 8 bytes: an int or char sign-extended, a double
+ * as its bits, a string as a pointer, NULL for "". They behave as the
+ * instructions of kplvm do, so a program prints the same either way. */
+
+enum KplRuntimeError
+{
+  KPL_INDEX_OUT_OF_RANGE,
+  KPL_DIVISION_BY_ZERO,
+  KPL_INT_OVERFLOW,
+  KPL_STACK_OVERFLOW
+};
+
+// The lowest the stack may grow to; every routine checks it on entry
+extern char *kpl_stack_limit;
+
+// Sets kpl_stack_limit, from the stack's size limit
+void kpl_init(void);
+
+// Reports the error on stderr and ends the program with status 2
+void kpl_error(int err);
+
+int kpl_readc(void);
+int kpl_readi(void);
+void kpl_writec(int64_t c);
+void kpl_writei(int64_t i);
+void kpl_writed(int64_t bits);
+void kpl_writes(const char *s);
+void kpl_writeln(void);
+
+int kpl_power(int base, int exponent);
+int64_t kpl_power_double(int64_t bits, int exponent);
+char *kpl_concat(const char *s1, const char *s2);
+int kpl_compare(const char *s1, const char *s2);
+// value, of TypeClass typeClass, as a string
+char *kpl_to_string(int64_t value, int typeClass);
+
+#endif
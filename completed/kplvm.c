@@ -0,0 +1,59 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "reader.h"
+#include "bytecode.h"
+#include "vm.h"
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  Bytecode bytecode;
+  enum Dispatch dispatch = DISPATCH_THREADED;
+  int listing = 0;
+  int arg = 1;
+  int result;
+
+  // -l: list the code instead of running it
+  // -d switch|threaded: how to dispatch instructions (threaded by default)
+  while (argc > arg + 1 && argv[arg][0] == '-' && argv[arg][1] != '\0') {
+    if (strcmp(argv[arg], "-l") == 0) {
+      listing = 1;
+      arg++;
+    } else if (strcmp(argv[arg], "-d") == 0 && argc > arg + 2 && strcmp(argv[arg + 1], "switch") == 0) {
+      dispatch = DISPATCH_SWITCH;
+      arg += 2;
+    } else if (strcmp(argv[arg], "-d") == 0 && argc > arg + 2 && strcmp(argv[arg + 1], "threaded") == 0) {
+      dispatch = DISPATCH_THREADED;
+      arg += 2;
+    } else {
+      printf("kplvm: bad option %s.\n", argv[arg]);
+      return -1;
+    }
+  }
+
+  if (argc <= arg) {
+    printf("kplvm: no input file.\n");
+    return -1;
+  }
+
+  if (loadBytecode(&bytecode, argv[arg]) == IO_ERROR) {
+    printf("Can\'t read bytecode file!\n");
+    return -1;
+  }
+
+  if (listing) {
+    printBytecode(&bytecode);
+    result = VM_SUCCESS;
+  } else
+    result = runBytecode(&bytecode, dispatch, NULL);
+
+  freeBytecode(&bytecode);
+  return result;
+}
@@ -6,22 +6,102 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "reader.h"
 #include "parser.h"
+#include "debug.h"
+
+// The runtime native programs are linked with, and the C compiler that
+// assembles and links them
+#ifndef KPL_RUNTIME
+#define KPL_RUNTIME "kplrt.o"
+#endif
+#ifndef KPL_CC
+#define KPL_CC "cc"
+#endif
 
 /******************************************************************/
 
+// Assembles and links assembly into the program executable
+static int linkProgram(char *assembly, char *executable) {
+  char *command[] = {KPL_CC, "-o", executable, assembly, KPL_RUNTIME, "-lm", NULL};
+  int status;
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    execvp(command[0], command);
+    _exit(127);
+  }
+  if (pid < 0 || waitpid(pid, &status, 0) < 0)
+    return 0;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
 int main(int argc, char *argv[]) {
-  if (argc <= 1) {
+  char assembly[] = "/tmp/kplcXXXXXX.s";
+  char *executable = NULL;
+  int arg = 1;
+  int result;
+  int fd;
+
+  // -j N: lex with N threads, a few chunks ahead of the parser
+  // -s text|json: print symbol-table and syntax-tree statistics to stderr
+  // -b file: write the program's bytecode to file, for kplvm
+  // -S file: write the program as x86-64 assembly to file
+  // -o file: compile the program to the executable file
+  // -O 0|1: fold constant expressions before generating code (1, the default) or not
+  while (argc > arg + 1 && argv[arg][0] == '-' && argv[arg][1] != '\0') {
+    if (strcmp(argv[arg], "-j") == 0)
+      lexThreads = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "-s") == 0 && strcmp(argv[arg + 1], "text") == 0)
+      symtabStats = STATS_TEXT;
+    else if (strcmp(argv[arg], "-s") == 0 && strcmp(argv[arg + 1], "json") == 0)
+      symtabStats = STATS_JSON;
+    else if (strcmp(argv[arg], "-b") == 0)
+      bytecodeFile = argv[arg + 1];
+    else if (strcmp(argv[arg], "-S") == 0)
+      assemblyFile = argv[arg + 1];
+    else if (strcmp(argv[arg], "-o") == 0)
+      executable = argv[arg + 1];
+    else if (strcmp(argv[arg], "-O") == 0 && (strcmp(argv[arg + 1], "0") == 0 || strcmp(argv[arg + 1], "1") == 0))
+      folding = atoi(argv[arg + 1]);
+    else {
+      printf("parser: bad option %s %s.\n", argv[arg], argv[arg + 1]);
+      return -1;
+    }
+    arg += 2;
+  }
+
+  if (argc <= arg) {
     printf("parser: no input file.\n");
     return -1;
   }
 
-  if (compile(argv[1]) == IO_ERROR) {
+  // without -S, the assembly for -o goes to a file of its own
+  if (executable != NULL && assemblyFile == NULL) {
+    if ((fd = mkstemps(assembly, 2)) < 0) {
+      printf("Can\'t write assembly file!\n");
+      return -1;
+    }
+    close(fd);
+    assemblyFile = assembly;
+  }
+
+  result = compile(argv[arg]);
+  if (result == IO_ERROR)
     printf("Can\'t read input file!\n");
-    return -1;
+  else if (result == IO_SUCCESS && executable != NULL && !linkProgram(assemblyFile, executable)) {
+    printf("Can\'t link %s!\n", executable);
+    result = COMPILE_ERROR;
   }
-    
+  if (assemblyFile == assembly)
+    unlink(assembly);
+
+  // a program with errors only fails the run when code was asked for
+  if (result != IO_SUCCESS && (result != COMPILE_ERROR || bytecodeFile != NULL || assemblyFile != NULL))
+    return -1;
   return 0;
 }
@@ -5,29 +5,46 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "reader.h"
 #include "scanner.h"
+#include "plex.h"
 #include "parser.h"
 #include "semantics.h"
 #include "error.h"
 #include "debug.h"
-
-Token *currentToken;
-Token *lookAhead;
+#include "intern.h"
+#include "session.h"
+#include "ast.h"
+#include "codegen.h"
+#include "asmgen.h"
+#include "fold.h"
+
+// The state of a compilation is per thread, so that several compilations
+// can run side by side in one process.
+static __thread ScannerContext *scanner;
+__thread Token *currentToken;
+__thread Token *lookAhead;
+static __thread CheckSession *session; // the one recheck() runs, if any
+
+int lexThreads = 1; // more than one: lex the input in parallel, ahead of the parser
+int symtabStats = STATS_NONE;
+char *bytecodeFile = NULL;
+char *assemblyFile = NULL;
+int folding = 1;
 
 extern Type *intType;
 extern Type *charType;
 extern Type *doubleType;
 extern Type *stringType;
-extern SymTab *symtab;
+extern __thread SymTab *symtab;
+extern __thread Ast *ast;
 
 void scan(void)
 {
-  Token *tmp = currentToken;
   currentToken = lookAhead;
-  lookAhead = getValidToken();
-  free(tmp);
+  lookAhead = getValidToken(scanner);
 }
 
 void eat(TokenType tokenType)
@@ -41,6 +58,35 @@ void eat(TokenType tokenType)
     missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
 }
 
+// A node for the statement that must be here, even if none was written
+static NodeId statementNode(NodeId statement)
+{
+  return (statement != NO_NODE) ? statement : newNode(N_EMPTY, 0);
+}
+
+// A node with two children, typed as checking sees it
+static NodeId makePair(enum NodeKind kind, int op, NodeId first, NodeId second, Type *type)
+{
+  NodeList children = {NO_NODE, NO_NODE};
+  NodeId node = newNode(kind, 0);
+
+  getNode(node)->op = op;
+  setNodeType(node, type);
+  appendNode(&children, first);
+  appendNode(&children, second);
+  setChildren(node, &children);
+  return node;
+}
+
+// A node whose children are first and the nodes chained after it
+static NodeId makeParent(enum NodeKind kind, int value, NodeId first)
+{
+  NodeId node = newNode(kind, value);
+
+  getNode(node)->child = first;
+  return node;
+}
+
 void compileProgram(void)
 {
   Object *program;
@@ -48,21 +94,21 @@ void compileProgram(void)
   eat(KW_PROGRAM);
   eat(TK_IDENT);
 
-  program = createProgramObject(currentToken->string);
+  program = createProgramObject(currentToken->name);
   enterBlock(program->progAttrs->scope);
 
   eat(SB_SEMICOLON);
 
-  compileBlock();
+  ast->root = makeParent(N_ROUTINE, program->id, compileBlock());
   eat(SB_PERIOD);
 
   exitBlock();
 }
 
-void compileBlock(void)
+NodeId compileBlock(void)
 {
   Object *constObj;
-  ConstantValue *constValue;
+  ConstantId constValue;
 
   if (lookAhead->tokenType == KW_CONST)
   {
@@ -72,8 +118,8 @@ void compileBlock(void)
     {
       eat(TK_IDENT);
 
-      checkFreshIdent(currentToken->string);
-      constObj = createConstantObject(currentToken->string);
+      checkFreshIdent(currentToken->name);
+      constObj = createConstantObject(currentToken->name);
 
       eat(SB_EQ);
       constValue = compileConstant();
@@ -84,13 +130,13 @@ void compileBlock(void)
       eat(SB_SEMICOLON);
     } while (lookAhead->tokenType == TK_IDENT);
 
-    compileBlock2();
+    return compileBlock2();
   }
   else
-    compileBlock2();
+    return compileBlock2();
 }
 
-void compileBlock2(void)
+NodeId compileBlock2(void)
 {
   Object *typeObj;
   Type *actualType;
@@ -103,25 +149,25 @@ void compileBlock2(void)
     {
       eat(TK_IDENT);
 
-      checkFreshIdent(currentToken->string);
-      typeObj = createTypeObject(currentToken->string);
+      checkFreshIdent(currentToken->name);
+      typeObj = createTypeObject(currentToken->name);
 
       eat(SB_EQ);
       actualType = compileType();
 
-      typeObj->typeAttrs->actualType = actualType;
+      setObjectType(typeObj, actualType);
       declareObject(typeObj);
 
       eat(SB_SEMICOLON);
     } while (lookAhead->tokenType == TK_IDENT);
 
-    compileBlock3();
+    return compileBlock3();
   }
   else
-    compileBlock3();
+    return compileBlock3();
 }
 
-void compileBlock3(void)
+NodeId compileBlock3(void)
 {
   Object *varObj;
   Type *varType;
@@ -134,58 +180,80 @@ void compileBlock3(void)
     {
       eat(TK_IDENT);
 
-      checkFreshIdent(currentToken->string);
-      varObj = createVariableObject(currentToken->string);
+      checkFreshIdent(currentToken->name);
+      varObj = createVariableObject(currentToken->name);
 
       eat(SB_COLON);
       varType = compileType();
 
-      varObj->varAttrs->type = varType;
+      setObjectType(varObj, varType);
       declareObject(varObj);
 
       eat(SB_SEMICOLON);
     } while (lookAhead->tokenType == TK_IDENT);
 
-    compileBlock4();
+    return compileBlock4();
   }
   else
-    compileBlock4();
+    return compileBlock4();
 }
 
-void compileBlock4(void)
+static void compileUnits(size_t offset);
+
+// The procedures and functions of the block, then its body; a check
+// session keeps no tree of the program's (see session.h)
+NodeId compileBlock4(void)
 {
-  compileSubDecls();
-  compileBlock5();
+  NodeList children = {NO_NODE, NO_NODE};
+
+  if ((session != NULL) && (symtab->depth == 1))
+  {
+    // the header ends here: see session.h
+    session->headerEnd = (const unsigned char *)currentToken->text + currentToken->length - scanner->input.buffer;
+    session->headerLineNo = currentToken->lineNo;
+    session->headerCount = symtab->currentScope->objectCount;
+    compileUnits(session->headerEnd);
+  }
+  else
+  {
+    compileSubDecls(&children);
+    appendNode(&children, compileBlock5());
+  }
+  return children.first;
 }
 
-void compileBlock5(void)
+NodeId compileBlock5(void)
 {
+  NodeId statements;
+
   eat(KW_BEGIN);
-  compileStatements();
+  statements = compileStatements();
   eat(KW_END);
+  return makeParent(N_GROUP, 0, statements);
 }
 
-void compileSubDecls(void)
+void compileSubDecls(NodeList *routines)
 {
   while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE))
   {
     if (lookAhead->tokenType == KW_FUNCTION)
-      compileFuncDecl();
+      appendNode(routines, compileFuncDecl());
     else
-      compileProcDecl();
+      appendNode(routines, compileProcDecl());
   }
 }
 
-void compileFuncDecl(void)
+NodeId compileFuncDecl(void)
 {
   Object *funcObj;
   Type *returnType;
+  NodeId block;
 
   eat(KW_FUNCTION);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  funcObj = createFunctionObject(currentToken->string);
+  checkFreshIdent(currentToken->name);
+  funcObj = createFunctionObject(currentToken->name);
   declareObject(funcObj);
 
   enterBlock(funcObj->funcAttrs->scope);
@@ -194,24 +262,26 @@ void compileFuncDecl(void)
 
   eat(SB_COLON);
   returnType = compileBasicType();
-  funcObj->funcAttrs->returnType = returnType;
+  setObjectType(funcObj, returnType);
 
   eat(SB_SEMICOLON);
-  compileBlock();
+  block = compileBlock();
   eat(SB_SEMICOLON);
 
   exitBlock();
+  return makeParent(N_ROUTINE, funcObj->id, block);
 }
 
-void compileProcDecl(void)
+NodeId compileProcDecl(void)
 {
   Object *procObj;
+  NodeId block;
 
   eat(KW_PROCEDURE);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  procObj = createProcedureObject(currentToken->string);
+  checkFreshIdent(currentToken->name);
+  procObj = createProcedureObject(currentToken->name);
   declareObject(procObj);
 
   enterBlock(procObj->procAttrs->scope);
@@ -219,15 +289,16 @@ void compileProcDecl(void)
   compileParams();
 
   eat(SB_SEMICOLON);
-  compileBlock();
+  block = compileBlock();
   eat(SB_SEMICOLON);
 
   exitBlock();
+  return makeParent(N_ROUTINE, procObj->id, block);
 }
 
-ConstantValue *compileUnsignedConstant(void)
+ConstantId compileUnsignedConstant(void)
 {
-  ConstantValue *constValue;
+  ConstantId constValue;
   Object *obj;
 
   switch (lookAhead->tokenType)
@@ -239,13 +310,13 @@ ConstantValue *compileUnsignedConstant(void)
   case TK_IDENT:
     eat(TK_IDENT);
 
-    obj = checkDeclaredConstant(currentToken->string);
-    constValue = duplicateConstantValue(obj->constAttrs->value);
+    obj = checkDeclaredConstant(currentToken->name);
+    constValue = obj->constAttrs->value;
 
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
+    constValue = makeCharConstant(currentToken->text[0]);
     break;
   default:
     error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
@@ -254,9 +325,9 @@ ConstantValue *compileUnsignedConstant(void)
   return constValue;
 }
 
-ConstantValue *compileConstant(void)
+ConstantId compileConstant(void)
 {
-  ConstantValue *constValue;
+  ConstantId constValue;
 
   switch (lookAhead->tokenType)
   {
@@ -266,12 +337,11 @@ ConstantValue *compileConstant(void)
     break;
   case SB_MINUS:
     eat(SB_MINUS);
-    constValue = compileConstant2();
-    constValue->intValue = -constValue->intValue;
+    constValue = negateConstant(compileConstant2());
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
+    constValue = makeCharConstant(currentToken->text[0]);
     break;
   default:
     constValue = compileConstant2();
@@ -280,9 +350,9 @@ ConstantValue *compileConstant(void)
   return constValue;
 }
 
-ConstantValue *compileConstant2(void)
+ConstantId compileConstant2(void)
 {
-  ConstantValue *constValue;
+  ConstantId constValue;
   Object *obj;
 
   switch (lookAhead->tokenType)
@@ -293,17 +363,17 @@ ConstantValue *compileConstant2(void)
     break;
   case TK_DOUBLE:
     eat(TK_DOUBLE);
-    constValue = makeDoubleConstant(currentToken->value);
+    constValue = makeDoubleConstant(currentToken->doubleValue);
     break;
   case TK_STRING:
     eat(TK_STRING);
-    constValue = makeStringConstant(currentToken->string);
+    constValue = makeStringConstant(currentToken->text, currentToken->length);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredConstant(currentToken->string);
-    if (obj->constAttrs->value->type == TP_INT)
-      constValue = duplicateConstantValue(obj->constAttrs->value);
+    obj = checkDeclaredConstant(currentToken->name);
+    if (constantValue(obj->constAttrs->value)->type == TP_INT)
+      constValue = obj->constAttrs->value;
     else
       error(ERR_UNDECLARED_INT_CONSTANT, currentToken->lineNo, currentToken->colNo);
     break;
@@ -353,8 +423,8 @@ Type *compileType(void)
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredType(currentToken->string);
-    type = duplicateType(obj->typeAttrs->actualType);
+    obj = checkDeclaredType(currentToken->name);
+    type = objectType(obj);
     break;
   default:
     error(ERR_INVALID_TYPE, lookAhead->lineNo, lookAhead->colNo);
@@ -416,21 +486,21 @@ void compileParam(void)
   {
   case TK_IDENT:
     eat(TK_IDENT);
-    checkFreshIdent(currentToken->string);
-    param = createParameterObject(currentToken->string, PARAM_VALUE, symtab->currentScope->owner);
+    checkFreshIdent(currentToken->name);
+    param = createParameterObject(currentToken->name, PARAM_VALUE, symtab->currentScope->owner);
     eat(SB_COLON);
     type = compileBasicType();
-    param->paramAttrs->type = type;
+    setObjectType(param, type);
     declareObject(param);
     break;
   case KW_VAR:
     eat(KW_VAR);
     eat(TK_IDENT);
-    checkFreshIdent(currentToken->string);
-    param = createParameterObject(currentToken->string, PARAM_REFERENCE, symtab->currentScope->owner);
+    checkFreshIdent(currentToken->name);
+    param = createParameterObject(currentToken->name, PARAM_REFERENCE, symtab->currentScope->owner);
     eat(SB_COLON);
     type = compileBasicType();
-    param->paramAttrs->type = type;
+    setObjectType(param, type);
     declareObject(param);
     break;
   default:
@@ -439,51 +509,57 @@ void compileParam(void)
   }
 }
 
-void compileStatements(void)
+NodeId compileStatements(void)
 {
-  compileStatement();
+  NodeList statements = {NO_NODE, NO_NODE};
+
+  appendNode(&statements, compileStatement());
   while (lookAhead->tokenType == SB_SEMICOLON)
   {
     eat(SB_SEMICOLON);
-    compileStatement();
+    appendNode(&statements, compileStatement());
   }
+  return statements.first;
 }
 
-void compileStatement(void)
+NodeId compileStatement(void)
 {
+  NodeId statement = NO_NODE;
+
   switch (lookAhead->tokenType)
   {
   case TK_IDENT:
-    compileAssignSt();
+    statement = compileAssignSt();
     break;
   case KW_CALL:
-    compileCallSt();
+    statement = compileCallSt();
     break;
   case KW_BEGIN:
-    compileGroupSt();
+    statement = compileGroupSt();
     break;
   case KW_IF:
-    compileIfSt();
+    statement = compileIfSt();
     break;
   case KW_WHILE:
-    compileWhileSt();
+    statement = compileWhileSt();
     break;
   case KW_FOR:
-    compileForSt();
+    statement = compileForSt();
     break;
   case KW_SWITCH:
-    compileSwitchSt();
+    statement = compileSwitchSt();
     break;
   case KW_CASE:
-    compileCaseSt();
+    statement = compileCaseSt();
     break;
   case KW_DEFAULT:
     eat(KW_DEFAULT);
     eat(SB_COLON);
-    compileStatement();
+    statement = makeParent(N_DEFAULT, 0, statementNode(compileStatement()));
     break;
   case KW_BREAK:
     eat(KW_BREAK);
+    statement = newNode(N_BREAK, 0);
     break;
     // EmptySt needs to check FOLLOW tokens
   case SB_SEMICOLON:
@@ -495,169 +571,199 @@ void compileStatement(void)
     error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
     break;
   }
+  return statement;
 }
 
-Type *compileLValue(void)
+NodeId compileLValue(void)
 {
   Object *var;
-  Type *varType;
+  NodeId lvalue;
 
   eat(TK_IDENT);
 
-  var = checkDeclaredLValueIdent(currentToken->string);
+  var = checkDeclaredLValueIdent(currentToken->name);
 
   switch (var->kind)
   {
   case OBJ_VARIABLE:
-    if (var->varAttrs->type->typeClass == TP_ARRAY)
-      varType = compileIndexes(var->varAttrs->type);
+    if (objectType(var)->typeClass == TP_ARRAY)
+      lvalue = compileIndexes(var);
     else
-      varType = var->varAttrs->type;
+    {
+      lvalue = newNode(N_VARIABLE, var->id);
+      setNodeType(lvalue, objectType(var));
+    }
     break;
   case OBJ_PARAMETER:
-    varType = var->paramAttrs->type;
-    break;
   case OBJ_FUNCTION:
-    varType = var->funcAttrs->returnType;
+    lvalue = newNode(N_VARIABLE, var->id);
+    setNodeType(lvalue, objectType(var));
     break;
   default:
     error(ERR_INVALID_LVALUE, currentToken->lineNo, currentToken->colNo);
   }
 
-  return varType;
+  return lvalue;
 }
 
-void compileAssignSt(void)
+NodeId compileAssignSt(void)
 {
   // printf("conmpile assign");
-  Type *varType;
-  Type *expType;
+  NodeId var;
+  NodeId exp;
 
-  varType = compileLValue();
+  var = compileLValue();
 
   eat(SB_ASSIGN);
-  expType = compileExpression();
+  exp = compileExpression();
 
-  checkTypeEquality(varType, expType);
+  checkTypeEquality(nodeType(var), nodeType(exp));
+  return makePair(N_ASSIGN, 0, var, exp, nodeType(var));
 }
 
-void compileCallSt(void)
+NodeId compileCallSt(void)
 {
   Object *proc;
 
   eat(KW_CALL);
   eat(TK_IDENT);
 
-  proc = checkDeclaredProcedure(currentToken->string);
+  proc = checkDeclaredProcedure(currentToken->name);
 
-  compileArguments(proc->procAttrs->paramList);
+  return makeParent(N_CALL, proc->id, compileArguments(proc));
 }
 
-void compileGroupSt(void)
+NodeId compileGroupSt(void)
 {
+  NodeId statements;
+
   eat(KW_BEGIN);
-  compileStatements();
+  statements = compileStatements();
   eat(KW_END);
+  return makeParent(N_GROUP, 0, statements);
 }
 
-void compileIfSt(void)
+NodeId compileIfSt(void)
 {
+  NodeList children = {NO_NODE, NO_NODE};
+  NodeId node;
+
   eat(KW_IF);
-  compileCondition();
+  appendNode(&children, compileCondition());
   eat(KW_THEN);
-  compileStatement();
+  appendNode(&children, statementNode(compileStatement()));
   if (lookAhead->tokenType == KW_ELSE)
-    compileElseSt();
+    appendNode(&children, compileElseSt());
+
+  node = newNode(N_IF, 0);
+  setChildren(node, &children);
+  return node;
 }
 
-void compileElseSt(void)
+NodeId compileElseSt(void)
 {
   eat(KW_ELSE);
-  compileStatement();
+  return statementNode(compileStatement());
 }
 
-void compileWhileSt(void)
+NodeId compileWhileSt(void)
 {
+  NodeId condition;
+
   eat(KW_WHILE);
-  compileCondition();
+  condition = compileCondition();
   eat(KW_DO);
-  compileStatement();
+  return makePair(N_WHILE, 0, condition, statementNode(compileStatement()), intType);
 }
 
-void compileForSt(void)
+NodeId compileForSt(void)
 {
+  NodeList children = {NO_NODE, NO_NODE};
   Object *var;
-  Type *type;
+  NodeId exp;
+  NodeId node;
 
   eat(KW_FOR);
   eat(TK_IDENT);
 
-  var = checkDeclaredVariable(currentToken->string);
+  var = checkDeclaredVariable(currentToken->name);
 
   eat(SB_ASSIGN);
-  type = compileExpression();
-  checkTypeEquality(var->varAttrs->type, type);
+  exp = compileExpression();
+  checkTypeEquality(objectType(var), nodeType(exp));
+  checkNumberType(objectType(var)); // it counts up by 1
+  appendNode(&children, exp);
 
   eat(KW_TO);
-  type = compileExpression();
-  checkTypeEquality(var->varAttrs->type, type);
+  exp = compileExpression();
+  checkTypeEquality(objectType(var), nodeType(exp));
+  appendNode(&children, exp);
 
   eat(KW_DO);
-  compileStatement();
+  appendNode(&children, statementNode(compileStatement()));
+
+  node = newNode(N_FOR, var->id);
+  setChildren(node, &children);
+  return node;
 }
-void compileSwitchSt(void)
+NodeId compileSwitchSt(void)
 {
+  NodeId exp;
+
   eat(KW_SWITCH);
-  compileExpression();
-  compileStatement();
+  exp = compileExpression();
+  return makePair(N_SWITCH, 0, exp, statementNode(compileStatement()), nodeType(exp));
 }
-void compileCaseSt(void)
+NodeId compileCaseSt(void)
 {
+  ConstantId value;
+
   eat(KW_CASE);
-  compileConstant();
+  value = compileConstant();
   eat(SB_COLON);
-  compileStatements();
+  return makeParent(N_CASE, value, compileStatements());
 }
 
-void compileArgument(Object *param)
+NodeId compileArgument(Object *param)
 {
-  Type *type;
+  NodeId arg;
 
   if (param->paramAttrs->kind == PARAM_VALUE)
   {
-    type = compileExpression();
-    checkTypeEquality(type, param->paramAttrs->type);
+    arg = compileExpression();
+    checkTypeEquality(nodeType(arg), objectType(param));
   }
   else
   {
-    type = compileLValue();
-    checkTypeEquality(type, param->paramAttrs->type);
+    arg = compileLValue();
+    checkTypeEquality(nodeType(arg), objectType(param));
   }
+  return arg;
 }
 
-void compileArguments(ObjectNode *paramList)
+NodeId compileArguments(Object *callee)
 {
-  ObjectNode *node = paramList;
+  NodeList args = {NO_NODE, NO_NODE};
+  int paramCount = countParams(callee);
+  int i = 0;
 
   switch (lookAhead->tokenType)
   {
   case SB_LPAR:
     eat(SB_LPAR);
-    if (node == NULL)
+    if (i == paramCount)
       error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-    compileArgument(node->object);
-    node = node->next;
+    appendNode(&args, compileArgument(getParam(callee, i++)));
 
     while (lookAhead->tokenType == SB_COMMA)
     {
       eat(SB_COMMA);
-      if (node == NULL)
+      if (i == paramCount)
         error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-      compileArgument(node->object);
-      node = node->next;
+      appendNode(&args, compileArgument(getParam(callee, i++)));
     }
 
-    if (node != NULL)
+    if (i < paramCount)
       error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
 
     eat(SB_RPAR);
@@ -686,17 +792,20 @@ void compileArguments(ObjectNode *paramList)
   default:
     error(ERR_INVALID_ARGUMENTS, lookAhead->lineNo, lookAhead->colNo);
   }
+  return args.first;
 }
 
-void compileCondition(void)
+NodeId compileCondition(void)
 {
-  Type *type1;
-  Type *type2;
+  NodeId exp1;
+  NodeId exp2;
+  TokenType op;
 
-  type1 = compileExpression();
-  checkBasicType(type1);
+  exp1 = compileExpression();
+  checkBasicType(nodeType(exp1));
 
-  switch (lookAhead->tokenType)
+  op = lookAhead->tokenType;
+  switch (op)
   {
   case SB_EQ:
     eat(SB_EQ);
@@ -720,61 +829,63 @@ void compileCondition(void)
     error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
   }
 
-  type2 = compileExpression();
-  checkTypeEquality(type1, type2);
+  exp2 = compileExpression();
+  checkTypeEquality(nodeType(exp1), nodeType(exp2));
+  return makePair(N_COMPARE, op, exp1, exp2, intType);
 }
 
-Type *compileExpression(void)
+NodeId compileExpression(void)
 {
   // printf("this is to check compile expression");
-  Type *type;
+  NodeId exp;
 
   switch (lookAhead->tokenType)
   {
   case SB_PLUS:
     eat(SB_PLUS);
-    type = compileExpression2();
-    printf("check assign");
+    exp = compileExpression2();
     break;
   case SB_MINUS:
     eat(SB_MINUS);
-    type = compileExpression2();
-    checkAssignType(type);
+    // the sign belongs to the first term only
+    exp = compileTerm();
+    exp = compileExpression3(makePair(N_NEGATE, 0, exp, NO_NODE, nodeType(exp)));
+    checkAssignType(nodeType(exp));
+    checkNumberType(nodeType(exp));
     break;
   default:
-    type = compileExpression2();
+    exp = compileExpression2();
   }
-  return type;
+  return exp;
 }
 
-Type *compileExpression2(void)
+NodeId compileExpression2(void)
 {
-  Type *type;
-
-  type = compileTerm();
-  compileExpression3();
-
-  return type;
+  return compileExpression3(compileTerm());
 }
 
-void compileExpression3(void)
+// A chain of + and - has the type of its first term
+NodeId compileExpression3(NodeId exp)
 {
-  Type *type;
+  NodeId term;
 
   switch (lookAhead->tokenType)
   {
   case SB_PLUS:
     eat(SB_PLUS);
-    type = compileTerm();
-    checkAssignType(type);
-    compileExpression3();
-    break;
+    term = compileTerm();
+    checkAssignType(nodeType(term));
+    // a string is only ever added to a string, which it is joined to
+    if (nodeType(term)->typeClass == TP_STRING)
+      checkStringType(nodeType(exp));
+    return compileExpression3(makePair(N_BINARY, SB_PLUS, exp, term, nodeType(exp)));
   case SB_MINUS:
     eat(SB_MINUS);
-    type = compileTerm();
-    checkAssignType(type);
-    compileExpression3();
-    break;
+    term = compileTerm();
+    checkAssignType(nodeType(term));
+    checkNumberType(nodeType(exp));
+    checkNumberType(nodeType(term));
+    return compileExpression3(makePair(N_BINARY, SB_MINUS, exp, term, nodeType(exp)));
     // check the FOLLOW set
   case KW_TO:
   case KW_DO:
@@ -796,43 +907,40 @@ void compileExpression3(void)
   default:
     error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
   }
+  return exp;
 }
 
-Type *compileTerm(void)
+NodeId compileTerm(void)
 {
-  Type *type;
-
-  type = compileFactor();
-  compileTerm2();
-
-  return type;
+  return compileTerm2(compileFactor());
 }
 
-void compileTerm2(void)
+// Likewise a chain of *, / and ** has the type of its first factor
+NodeId compileTerm2(NodeId term)
 {
-  Type *type;
+  NodeId factor;
   // printToken(lookAhead);
 
   switch (lookAhead->tokenType)
   {
   case SB_TIMES:
     eat(SB_TIMES);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
+    factor = compileFactor();
+    checkIntType(nodeType(factor));
+    checkNumberType(nodeType(term));
+    return compileTerm2(makePair(N_BINARY, SB_TIMES, term, factor, nodeType(term)));
   case SB_SLASH:
     eat(SB_SLASH);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
+    factor = compileFactor();
+    checkIntType(nodeType(factor));
+    checkNumberType(nodeType(term));
+    return compileTerm2(makePair(N_BINARY, SB_SLASH, term, factor, nodeType(term)));
   case SB_POWER:
     eat(SB_POWER);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
+    factor = compileFactor();
+    checkIntType(nodeType(factor));
+    checkNumberType(nodeType(term));
+    return compileTerm2(makePair(N_BINARY, SB_POWER, term, factor, nodeType(term)));
     // check the FOLLOW set
   case SB_PLUS:
   case SB_MINUS:
@@ -858,11 +966,12 @@ void compileTerm2(void)
     // break;
     error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
   }
+  return term;
 }
 
-Type *compileFactor(void)
+NodeId compileFactor(void)
 {
-  Type *type;
+  NodeId factor;
   Object *obj;
   // printToken(lookAhead);
 
@@ -870,57 +979,66 @@ Type *compileFactor(void)
   {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    type = intType;
+    factor = newNode(N_NUMBER, currentToken->value);
+    setNodeType(factor, intType);
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    type = charType;
+    factor = newNode(N_CHAR, (unsigned char)currentToken->text[0]);
+    setNodeType(factor, charType);
     break;
   case TK_STRING:
     eat(TK_STRING);
-    type = stringType;
+    factor = newNode(N_LITERAL, makeStringConstant(currentToken->text, currentToken->length));
+    setNodeType(factor, stringType);
     break;
   case TK_DOUBLE:
     eat(TK_DOUBLE);
-    type = doubleType;
+    factor = newNode(N_LITERAL, makeDoubleConstant(currentToken->doubleValue));
+    setNodeType(factor, doubleType);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredIdent(currentToken->string);
+    obj = checkDeclaredIdent(currentToken->name);
 
     switch (obj->kind)
     {
     case OBJ_CONSTANT:
-      switch (obj->constAttrs->value->type)
+      factor = newNode(N_CONSTANT, obj->id);
+      switch (constantValue(obj->constAttrs->value)->type)
       {
       case TP_INT:
-        type = intType;
+        setNodeType(factor, intType);
         break;
       case TP_CHAR:
-        type = charType;
+        setNodeType(factor, charType);
         break;
       case TP_STRING:
-        type = stringType;
+        setNodeType(factor, stringType);
         break;
       case TP_DOUBLE:
-        type = doubleType;
+        setNodeType(factor, doubleType);
         break;
       default:
         break;
       }
       break;
     case OBJ_VARIABLE:
-      if (obj->varAttrs->type->typeClass == TP_ARRAY)
-        type = compileIndexes(obj->varAttrs->type);
+      if (objectType(obj)->typeClass == TP_ARRAY)
+        factor = compileIndexes(obj);
       else
-        type = obj->varAttrs->type;
+      {
+        factor = newNode(N_VARIABLE, obj->id);
+        setNodeType(factor, objectType(obj));
+      }
       break;
     case OBJ_PARAMETER:
-      type = obj->paramAttrs->type;
+      factor = newNode(N_VARIABLE, obj->id);
+      setNodeType(factor, objectType(obj));
       break;
     case OBJ_FUNCTION:
-      compileArguments(obj->funcAttrs->paramList);
-      type = obj->funcAttrs->returnType;
+      factor = makeParent(N_FUNCALL, obj->id, compileArguments(obj));
+      setNodeType(factor, objectType(obj));
       break;
     default:
       error(ERR_INVALID_FACTOR, currentToken->lineNo, currentToken->colNo);
@@ -931,44 +1049,242 @@ Type *compileFactor(void)
     error(ERR_INVALID_FACTOR, lookAhead->lineNo, lookAhead->colNo);
   }
 
-  return type;
+  return factor;
 }
 
-Type *compileIndexes(Type *arrayType)
+NodeId compileIndexes(Object *array)
 {
-  Type *type;
+  NodeList indexes = {NO_NODE, NO_NODE};
+  Type *arrayType = objectType(array);
+  NodeId index;
+  NodeId node;
 
   while (lookAhead->tokenType == SB_LSEL)
   {
     eat(SB_LSEL);
-    type = compileExpression();
-    checkIntType(type);
+    index = compileExpression();
+    checkIntType(nodeType(index));
     checkArrayType(arrayType);
     arrayType = arrayType->elementType;
     eat(SB_RSEL);
+    appendNode(&indexes, index);
   }
   checkBasicType(arrayType);
-  return arrayType;
+
+  node = newNode(N_INDEX, array->id);
+  setChildren(node, &indexes);
+  setNodeType(node, arrayType);
+  return node;
 }
 
-int compile(char *fileName)
+/******************************************************************/
+
+// Compiles the procedure, function or body at lookAhead, which starts at
+// offset, or skips it when the session can reuse it. Returns where it ends.
+static size_t compileUnit(size_t offset)
 {
-  if (openInputStream(fileName) == IO_ERROR)
+  TokenType tokenType = lookAhead->tokenType;
+  CheckedUnit *unit = findReusableUnit(session, offset);
+
+  if (unit != NULL)
+  {
+    unit = reuseUnit(session, unit, offset);
+    if (unit->object != NULL)
+      declareObject(unit->object);
+    seekScanner(scanner, unit->end, unit->endLineNo);
+    lookAhead = getValidToken(scanner);
+    return unit->end;
+  }
+
+  unit = addUnit(session, offset);
+  symtab->dependencies = &unit->dependencies;
+  if (tokenType == KW_FUNCTION)
+    compileFuncDecl();
+  else if (tokenType == KW_PROCEDURE)
+    compileProcDecl();
+  else
+    compileBlock5();
+  symtab->dependencies = NULL;
+
+  if (tokenType == KW_BEGIN)
+  {
+    // the body ends at the '.' after it
+    unit->end = (const unsigned char *)lookAhead->text - scanner->input.buffer;
+    unit->endLineNo = lookAhead->lineNo;
+  }
+  else
+  {
+    unit->object = scopeObject(symtab->currentScope, symtab->currentScope->objectCount - 1);
+    unit->end = (const unsigned char *)currentToken->text + currentToken->length - scanner->input.buffer;
+    unit->endLineNo = currentToken->lineNo;
+  }
+  finishDependencies(&unit->dependencies, unit->object);
+  return unit->end;
+}
+
+static void compileUnits(size_t offset)
+{
+  while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE))
+    offset = compileUnit(offset);
+  compileUnit(offset);
+}
+
+// Checks the session's new version against the header it already has.
+// Fails, having changed nothing, when a full check is needed instead.
+static int recheckUnits(void)
+{
+  if (!beginEdit(session, &scanner->input))
+    return 0;
+
+  // text added after the header may carry on its last declarations
+  seekScanner(scanner, session->headerEnd, session->headerLineNo);
+  lookAhead = getValidToken(scanner);
+  if ((lookAhead->tokenType != KW_FUNCTION) && (lookAhead->tokenType != KW_PROCEDURE) &&
+      (lookAhead->tokenType != KW_BEGIN))
+    return 0;
+
+  reopenBlock(symtab->program->progAttrs->scope, session->headerCount);
+  compileUnits(session->headerEnd);
+  eat(SB_PERIOD);
+  exitBlock();
+  return 1;
+}
+
+int recheck(CheckSession *checkSession, char *fileName)
+{
+  ScannerContext context;
+  jmp_buf trap;
+  int result = IO_SUCCESS;
+
+  if (openScanner(&context, fileName) == IO_ERROR)
     return IO_ERROR;
+  scanner = &context;
+  countingStats = (symtabStats != STATS_NONE);
+  session = checkSession;
+  initAst();
 
-  currentToken = NULL;
-  lookAhead = getValidToken();
+  if (setjmp(trap) == 0)
+  {
+    errorTrap = &trap;
+
+    currentToken = NULL;
+    if (!recheckUnits())
+    {
+      beginFullCheck(session);
+      seekScanner(scanner, 0, 1);
+      lookAhead = getValidToken(scanner);
+      compileProgram();
+    }
+
+    printObject(symtab->program, 0);
+    endCheck(session, &context.input, 1);
+  }
+  else
+  {
+    result = context.input.failed ? IO_ERROR : COMPILE_ERROR;
+    endCheck(session, &context.input, 0);
+  }
+  errorTrap = NULL;
+
+  if (symtabStats != STATS_NONE)
+  {
+    printSymTabStats(symtab, symtabStats);
+    printAstStats(ast, symtabStats);
+  }
+  cleanAst();
+
+  closeScanner(&context);
+  scanner = NULL;
+  session = NULL;
+  return result;
+}
+
+// The writers return IO_SUCCESS or IO_ERROR, and remove what they wrote
+// of a regular file when they fail: whoever runs kplc must not find a
+// partial program to run
+static int writeBytecode(const char *fileName)
+{
+  Bytecode bytecode;
+  int result;
+
+  initBytecode(&bytecode);
+  generateCode(&bytecode);
+  result = saveBytecode(&bytecode, fileName);
+  freeBytecode(&bytecode);
+  if (result == IO_ERROR)
+    printf("Can\'t write bytecode file!\n");
+  return result;
+}
+
+static int writeAssembly(const char *fileName)
+{
+  FILE *f = fopen(fileName, "w");
+  struct stat st;
+  int ok, regular;
+
+  if (f != NULL)
+  {
+    regular = (fstat(fileno(f), &st) == 0) && S_ISREG(st.st_mode);
+    generateAssembly(f);
+    ok = !ferror(f);
+    if ((fclose(f) == 0) && ok)
+      return IO_SUCCESS;
+    if (regular)
+      remove(fileName);
+  }
+  printf("Can\'t write assembly file!\n");
+  return IO_ERROR;
+}
+
+int compile(char *fileName)
+{
+  ScannerContext context;
+  jmp_buf trap;
+  int result = IO_SUCCESS;
+
+  if (openScanner(&context, fileName) == IO_ERROR)
+    return IO_ERROR;
+  scanner = &context;
+  countingStats = (symtabStats != STATS_NONE);
 
   initSymTab();
+  initAst();
+
+  if (setjmp(trap) == 0)
+  {
+    errorTrap = &trap;
 
-  compileProgram();
+    if (lexThreads > 1)
+      lexInParallel(scanner, lexThreads);
 
-  printObject(symtab->program, 0);
+    currentToken = NULL;
+    lookAhead = getValidToken(scanner);
 
+    compileProgram();
+
+    printObject(symtab->program, 0);
+
+    if (folding && ((bytecodeFile != NULL) || (assemblyFile != NULL)))
+      foldConstants();
+    if ((bytecodeFile != NULL) && (writeBytecode(bytecodeFile) == IO_ERROR))
+      result = WRITE_ERROR;
+    if ((assemblyFile != NULL) && (writeAssembly(assemblyFile) == IO_ERROR))
+      result = WRITE_ERROR;
+  }
+  else
+    result = context.input.failed ? IO_ERROR : COMPILE_ERROR;
+  errorTrap = NULL;
+
+  if (symtabStats != STATS_NONE)
+  {
+    printSymTabStats(symtab, symtabStats);
+    printAstStats(ast, symtabStats);
+  }
+  cleanAst();
   cleanSymTab();
+  freeNames();
 
-  free(currentToken);
-  free(lookAhead);
-  closeInputStream();
-  return IO_SUCCESS;
+  closeScanner(&context);
+  scanner = NULL;
+  return result;
 }
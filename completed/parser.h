@@ -7,54 +7,69 @@
 #define __PARSER_H__
 #include "token.h"
 #include "symtab.h"
+#include "ast.h"
 
 void scan(void);
 void eat(TokenType tokenType);
 
 void compileProgram(void);
-void compileBlock(void);
-void compileBlock2(void);
-void compileBlock3(void);
-void compileBlock4(void);
-void compileBlock5(void);
+NodeId compileBlock(void);
+NodeId compileBlock2(void);
+NodeId compileBlock3(void);
+NodeId compileBlock4(void);
+NodeId compileBlock5(void);
 void compileConstDecls(void);
 void compileConstDecl(void);
 void compileTypeDecls(void);
 void compileTypeDecl(void);
 void compileVarDecls(void);
 void compileVarDecl(void);
-void compileSubDecls(void);
-void compileFuncDecl(void);
-void compileProcDecl(void);
-ConstantValue *compileUnsignedConstant(void);
-ConstantValue *compileConstant(void);
-ConstantValue *compileConstant2(void);
+void compileSubDecls(NodeList *routines);
+NodeId compileFuncDecl(void);
+NodeId compileProcDecl(void);
+ConstantId compileUnsignedConstant(void);
+ConstantId compileConstant(void);
+ConstantId compileConstant2(void);
 Type *compileType(void);
 Type *compileBasicType(void);
 void compileParams(void);
 void compileParam(void);
-void compileStatements(void);
-void compileStatement(void);
-Type *compileLValue(void);
-void compileAssignSt(void);
-void compileCallSt(void);
-void compileGroupSt(void);
-void compileIfSt(void);
-void compileElseSt(void);
-void compileWhileSt(void);
-void compileForSt(void);
-void compileSwitchSt(void);
-void compileCaseSt(void);
-void compileArgument(Object *param);
-void compileArguments(ObjectNode *paramList);
-void compileCondition(void);
-Type *compileExpression(void);
-Type *compileExpression2(void);
-void compileExpression3(void);
-Type *compileTerm(void);
-void compileTerm2(void);
-Type *compileFactor(void);
-Type *compileIndexes(Type *arrayType);
+// These return the statements' and expressions' nodes; a list of
+// statements or arguments comes back as the first node of its chain
+NodeId compileStatements(void);
+NodeId compileStatement(void);
+NodeId compileLValue(void);
+NodeId compileAssignSt(void);
+NodeId compileCallSt(void);
+NodeId compileGroupSt(void);
+NodeId compileIfSt(void);
+NodeId compileElseSt(void);
+NodeId compileWhileSt(void);
+NodeId compileForSt(void);
+NodeId compileSwitchSt(void);
+NodeId compileCaseSt(void);
+NodeId compileArgument(Object *param);
+NodeId compileArguments(Object *callee);
+NodeId compileCondition(void);
+NodeId compileExpression(void);
+NodeId compileExpression2(void);
+NodeId compileExpression3(NodeId exp);
+NodeId compileTerm(void);
+NodeId compileTerm2(NodeId term);
+NodeId compileFactor(void);
+NodeId compileIndexes(Object *array);
+
+// compile() returns IO_SUCCESS, IO_ERROR when the file cannot be read,
+// COMPILE_ERROR once an error has been reported, or WRITE_ERROR when the
+// bytecode or assembly asked for cannot be written.
+#define COMPILE_ERROR 2
+#define WRITE_ERROR 3
+
+extern int lexThreads;
+extern int symtabStats; // a StatsFormat (debug.h): print them at the end of compile()
+extern char *bytecodeFile; // where compile() writes the program's code for kplvm, if set
+extern char *assemblyFile; // likewise its x86-64 assembly (asmgen.h)
+extern int folding; // 0: generate the code without folding constants (fold.h) first
 
 int compile(char *fileName);
 
@@ -0,0 +1,335 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* The input is cut into chunks of at most CHUNK_SIZE bytes, which the
+ * threads take in order. A thread cannot know whether its chunk starts
+ * inside a comment or a string, so it guesses that it does not and lexes
+ * from the first byte, keeping the tokens that start in its chunk.
+ * Scanning is a function of the position alone: once a guessed token
+ * starts where the real token stream has a token, every following token is
+ * right too. getToken takes the chunks in order as the parser reads on
+ * (nextTokens); a chunk whose guesses never meet the real stream is lexed
+ * again from the position where the previous chunk left off.
+ *
+ * The threads stay at most LEX_AHEAD chunks per thread ahead of the
+ * parser, and a chunk's tokens are freed once the parser moves past it, so
+ * memory stays bounded however long the input is.
+ *
+ * Threads count lines relative to the start of their chunk and the merge
+ * adds the lines of the chunks before. A token at the very end of input
+ * (TK_EOF or an error) depends on what came before it, so it is always
+ * taken from the chunk that reached it. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "reader.h"
+#include "token.h"
+#include "scanner.h"
+#include "plex.h"
+
+// Smaller chunks are not worth handing to a thread
+#ifndef MIN_CHUNK_SIZE
+#define MIN_CHUNK_SIZE 4096
+#endif
+// Larger ones are cut into chunks of at most this many bytes
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE (256 * 1024)
+#endif
+// Chunks lexed or being lexed ahead of the parser, per thread
+#ifndef LEX_AHEAD
+#define LEX_AHEAD 2
+#endif
+
+typedef struct
+{
+  const unsigned char *buffer; // the whole input
+  const unsigned char *end;
+  const unsigned char *begin;  // first byte of the range
+  const unsigned char *limit;  // tokens starting here or later are not ours
+  Token *tokens;               // tokens starting in [begin, limit)
+  const unsigned char **starts;
+  int count;
+  int capacity;
+  Token boundary;              // the first token starting at or after limit
+  const unsigned char *boundaryStart;
+  int lines;                   // line breaks in [begin, limit)
+  int lexed;                   // a thread is done with it
+} Chunk;
+
+typedef struct
+{
+  TokenSupply supply; // first, so the scanner's pointer is the Lexer's
+  Chunk *chunks;
+  int chunkCount;
+  pthread_t *ids;
+  int threads;
+  pthread_mutex_t lock; // guards lexed, nextChunk, firstChunk and stopping
+  pthread_cond_t chunkLexed;
+  pthread_cond_t chunkFreed;
+  int nextChunk;  // the first chunk no thread has taken
+  int firstChunk; // the chunk the parser reads; those before are freed
+  int stopping;
+  int reading;    // the parser has tokens of firstChunk
+  const unsigned char *next; // where the next token of the stream starts
+  int lineOffset;            // the line the chunk after the last one read starts on
+} Lexer;
+
+static int isLast(Token *token)
+{
+  return (token->tokenType == TK_EOF) || (token->tokenType == TK_NONE);
+}
+
+static void addToken(Chunk *chunk, Token *token, const unsigned char *start)
+{
+  if (chunk->count == chunk->capacity)
+  {
+    chunk->capacity = (chunk->capacity == 0) ? 1024 : chunk->capacity * 2;
+    chunk->tokens = (Token *)realloc(chunk->tokens, chunk->capacity * sizeof(Token));
+    chunk->starts = (const unsigned char **)realloc(chunk->starts, chunk->capacity * sizeof(const unsigned char *));
+  }
+  chunk->tokens[chunk->count] = *token;
+  chunk->starts[chunk->count] = start;
+  chunk->count++;
+}
+
+// A cursor at pos, with lines counted from the start of the chunk
+static void startCursor(ScanCursor *cursor, Chunk *chunk, const unsigned char *pos)
+{
+  const unsigned char *p;
+
+  cursor->p = pos;
+  cursor->lineNo = 0;
+  cursor->pastEnd = 0;
+  cursor->inComment = 0;
+  for (p = chunk->begin; (p < pos) && ((p = memchr(p, '\n', pos - p)) != NULL); p++)
+    cursor->lineNo++;
+  for (p = pos; (p > chunk->buffer) && (p[-1] != '\n'); p--)
+    ;
+  cursor->lineStart = p;
+}
+
+// Lexes from pos until a token starts at or after the limit of the chunk,
+// or the stream ends inside it.
+static void lexChunk(Chunk *chunk, const unsigned char *pos)
+{
+  ScanCursor cursor;
+  Token token;
+  const unsigned char *start;
+
+  chunk->boundaryStart = NULL;
+  startCursor(&cursor, chunk, pos);
+  for (;;)
+  {
+    start = scanToken(&cursor, chunk->end, 0, &token);
+    if (start >= chunk->limit)
+    {
+      chunk->boundary = token;
+      chunk->boundaryStart = start;
+      return;
+    }
+    addToken(chunk, &token, start);
+    if (isLast(&token))
+      return;
+  }
+}
+
+static void lexWhole(Chunk *chunk)
+{
+  const unsigned char *p, *end;
+
+  end = (chunk->limit < chunk->end) ? chunk->limit : chunk->end;
+  chunk->lines = 0;
+  for (p = chunk->begin; (p < end) && ((p = memchr(p, '\n', end - p)) != NULL); p++)
+    chunk->lines++;
+
+  lexChunk(chunk, chunk->begin);
+}
+
+// Takes the chunks in order, waiting while it is too far ahead of the parser
+static void *lexWorker(void *arg)
+{
+  Lexer *lexer = (Lexer *)arg;
+  Chunk *chunk;
+
+  pthread_mutex_lock(&lexer->lock);
+  for (;;)
+  {
+    while (!lexer->stopping && (lexer->nextChunk < lexer->chunkCount) &&
+           (lexer->nextChunk >= lexer->firstChunk + LEX_AHEAD * lexer->threads))
+      pthread_cond_wait(&lexer->chunkFreed, &lexer->lock);
+    if (lexer->stopping || (lexer->nextChunk == lexer->chunkCount))
+      break;
+    chunk = &lexer->chunks[lexer->nextChunk++];
+    pthread_mutex_unlock(&lexer->lock);
+
+    lexWhole(chunk);
+
+    pthread_mutex_lock(&lexer->lock);
+    chunk->lexed = 1;
+    pthread_cond_broadcast(&lexer->chunkLexed);
+  }
+  pthread_mutex_unlock(&lexer->lock);
+  return NULL;
+}
+
+// Index of the token of the chunk starting at pos, or -1
+static int findStart(Chunk *chunk, const unsigned char *pos)
+{
+  int low = 0, high = chunk->count - 1, mid;
+
+  while (low <= high)
+  {
+    mid = (low + high) / 2;
+    if (chunk->starts[mid] == pos)
+      return mid;
+    if (chunk->starts[mid] < pos)
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+  return -1;
+}
+
+static void freeChunk(Chunk *chunk)
+{
+  free(chunk->tokens);
+  free(chunk->starts);
+  chunk->tokens = NULL;
+  chunk->starts = NULL;
+  chunk->count = chunk->capacity = 0;
+}
+
+// The tokens of the stream in the next chunk that has any, with their
+// lines counted from the start of the input. The parser is done with the
+// chunk it read before, which is freed.
+static Token *nextTokens(TokenSupply *supply, int *count)
+{
+  Lexer *lexer = (Lexer *)supply;
+  Chunk *chunk;
+  int k, i;
+
+  // the last chunk holds the end of input, so the stream ends in one
+  for (;;)
+  {
+    if (lexer->reading)
+    {
+      freeChunk(&lexer->chunks[lexer->firstChunk]);
+      pthread_mutex_lock(&lexer->lock);
+      lexer->firstChunk++;
+      pthread_cond_broadcast(&lexer->chunkFreed);
+      pthread_mutex_unlock(&lexer->lock);
+    }
+    lexer->reading = 1;
+
+    chunk = &lexer->chunks[lexer->firstChunk];
+    pthread_mutex_lock(&lexer->lock);
+    while (!chunk->lexed)
+      pthread_cond_wait(&lexer->chunkLexed, &lexer->lock);
+    pthread_mutex_unlock(&lexer->lock);
+
+    // a chunk the stream has passed lies inside one of its tokens
+    k = chunk->count;
+    if (lexer->next < chunk->limit)
+    {
+      k = findStart(chunk, lexer->next);
+      if (k < 0)
+      {
+        chunk->count = 0;
+        lexChunk(chunk, lexer->next);
+        k = 0;
+      }
+      if ((k == chunk->count) || !isLast(&chunk->tokens[chunk->count - 1]))
+      {
+        if (isLast(&chunk->boundary))
+          addToken(chunk, &chunk->boundary, chunk->boundaryStart);
+        else
+          lexer->next = chunk->boundaryStart;
+      }
+    }
+    for (i = k; i < chunk->count; i++)
+      chunk->tokens[i].lineNo += lexer->lineOffset;
+    lexer->lineOffset += chunk->lines;
+    if (k < chunk->count)
+    {
+      *count = chunk->count - k;
+      return chunk->tokens + k;
+    }
+  }
+}
+
+static void closeLexer(TokenSupply *supply)
+{
+  Lexer *lexer = (Lexer *)supply;
+  int i;
+
+  pthread_mutex_lock(&lexer->lock);
+  lexer->stopping = 1;
+  pthread_cond_broadcast(&lexer->chunkFreed);
+  pthread_mutex_unlock(&lexer->lock);
+  for (i = 0; i < lexer->threads; i++)
+    pthread_join(lexer->ids[i], NULL);
+
+  for (i = 0; i < lexer->chunkCount; i++)
+    freeChunk(&lexer->chunks[i]);
+  pthread_mutex_destroy(&lexer->lock);
+  pthread_cond_destroy(&lexer->chunkLexed);
+  pthread_cond_destroy(&lexer->chunkFreed);
+  free(lexer->chunks);
+  free(lexer->ids);
+  free(lexer);
+}
+
+int lexInParallel(ScannerContext *scanner, int threads)
+{
+  const unsigned char *inputBuffer = scanner->input.buffer;
+  size_t inputSize = scanner->input.size;
+  size_t chunkSize;
+  Lexer *lexer;
+  int i;
+
+  // a stream is only ever partly in memory: it is scanned as it comes
+  if (!scanner->input.atEnd)
+    return 0;
+
+  if (threads < 1)
+    threads = 1;
+  chunkSize = inputSize / threads + 1;
+  if (chunkSize > CHUNK_SIZE)
+    chunkSize = CHUNK_SIZE;
+  if (chunkSize < MIN_CHUNK_SIZE)
+    chunkSize = MIN_CHUNK_SIZE;
+
+  lexer = (Lexer *)calloc(1, sizeof(Lexer));
+  lexer->supply.next = nextTokens;
+  lexer->supply.close = closeLexer;
+  lexer->chunkCount = inputSize / chunkSize + 1;
+  if (threads > lexer->chunkCount)
+    threads = lexer->chunkCount;
+  lexer->threads = threads;
+  lexer->chunks = (Chunk *)calloc(lexer->chunkCount, sizeof(Chunk));
+  lexer->ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+  lexer->next = inputBuffer;
+  lexer->lineOffset = 1;
+  pthread_mutex_init(&lexer->lock, NULL);
+  pthread_cond_init(&lexer->chunkLexed, NULL);
+  pthread_cond_init(&lexer->chunkFreed, NULL);
+
+  for (i = 0; i < lexer->chunkCount; i++)
+  {
+    lexer->chunks[i].buffer = inputBuffer;
+    lexer->chunks[i].end = inputBuffer + inputSize;
+    lexer->chunks[i].begin = inputBuffer + chunkSize * i;
+    lexer->chunks[i].limit = (i == lexer->chunkCount - 1) ? inputBuffer + inputSize + 1 : inputBuffer + chunkSize * (i + 1);
+  }
+
+  for (i = 0; i < threads; i++)
+    pthread_create(&lexer->ids[i], NULL, lexWorker, lexer);
+
+  useTokens(scanner, &lexer->supply);
+  return 1;
+}
@@ -0,0 +1,19 @@
+/* Parallel lexing
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PLEX_H__
+#define __PLEX_H__
+
+#include "scanner.h"
+
+// Lexes the input with the given number of threads, a bounded number of
+// chunks ahead of the parser, and hands the tokens to getToken (see
+// useTokens) as it reads on. The result is the same token stream a
+// sequential scan produces, ending at TK_EOF or at the first error.
+// Returns 0 for a stream, which is left to the sequential scanner.
+int lexInParallel(ScannerContext *scanner, int threads);
+
+#endif
@@ -0,0 +1,30 @@
+/* Integer power
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __POWER_H__
+#define __POWER_H__
+
+/* What int ** int gives. kplvm's PW (vm.c), the native runtime's kpl_power
+ * (kplrt.c) and the folder (fold.c) all compute it here, so a folded power
+ * is the one the running program would get. An exponent below 0 gives the
+ * int part of 1 / base ** -exponent; past the range of int the result
+ * wraps around like the other int operators. */
+static inline int intPower(int base, int exponent)
+{
+  unsigned int result = 1, factor = (unsigned int)base;
+
+  if (exponent < 0)
+    return (base == 1) ? 1 : (base == -1) ? ((exponent & 1) ? -1 : 1) : 0;
+  for (; exponent > 0; exponent >>= 1)
+  {
+    if (exponent & 1)
+      result *= factor;
+    factor *= factor;
+  }
+  return (int)result;
+}
+
+#endif
@@ -5,37 +5,112 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "reader.h"
 
-FILE *inputStream;
-int lineNo, colNo;
-int currentChar;
+int openInputFd(InputStream *input, int fd)
+{
+  input->buffer = (const unsigned char *)malloc(STREAM_BUFFER_SIZE);
+  if (input->buffer == NULL)
+    return IO_ERROR;
+  input->size = 0;
+  input->capacity = STREAM_BUFFER_SIZE;
+  input->consumed = 0;
+  input->mapped = 0;
+  input->fd = fd;
+  input->atEnd = 0;
+  input->failed = 0;
+  return IO_SUCCESS;
+}
 
-int readChar(void)
+int openInputStream(InputStream *input, char *fileName)
 {
-  currentChar = getc(inputStream);
-  // printf("%c", currentChar);
-  colNo++;
-  if (currentChar == '\n')
+  struct stat st;
+  int fd;
+  void *data;
+
+  if (strcmp(fileName, "-") == 0)
+    return openInputFd(input, STDIN_FILENO);
+
+  fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return IO_ERROR;
+
+  if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0))
+  {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      close(fd);
+      input->buffer = (const unsigned char *)data;
+      input->size = st.st_size;
+      input->capacity = 0;
+      input->consumed = 0;
+      input->mapped = 1;
+      input->fd = -1;
+      input->atEnd = 1;
+      input->failed = 0;
+      return IO_SUCCESS;
+    }
+  }
+
+  // pipes, devices, empty files: read as a stream
+  if (openInputFd(input, fd) == IO_ERROR)
   {
-    lineNo++;
-    colNo = 0;
+    close(fd);
+    return IO_ERROR;
   }
-  return currentChar;
+  return IO_SUCCESS;
 }
 
-int openInputStream(char *fileName)
+int refillInputStream(InputStream *input, size_t keep)
 {
-  inputStream = fopen(fileName, "rt");
-  if (inputStream == NULL)
+  unsigned char *buffer = (unsigned char *)input->buffer;
+  ssize_t n;
+
+  if (input->atEnd)
+    return IO_ERROR;
+  if ((keep == 0) && (input->size == input->capacity))
     return IO_ERROR;
-  lineNo = 1;
-  colNo = 0;
-  readChar();
+
+  memmove(buffer, buffer + keep, input->size - keep);
+  input->size -= keep;
+  input->consumed += keep;
+
+  do
+    n = read(input->fd, buffer + input->size, input->capacity - input->size);
+  while ((n < 0) && (errno == EINTR));
+
+  // an error is not the end of the input: what follows is missing
+  if (n < 0)
+  {
+    input->failed = 1;
+    return IO_ERROR;
+  }
+  if (n == 0)
+    input->atEnd = 1;
+  else
+    input->size += n;
   return IO_SUCCESS;
 }
 
-void closeInputStream()
+void closeInputStream(InputStream *input)
 {
-  fclose(inputStream);
+  if (input->mapped)
+    munmap((void *)input->buffer, input->size);
+  else
+  {
+    free((void *)input->buffer);
+    if (input->fd != STDIN_FILENO)
+      close(input->fd);
+  }
+  input->buffer = NULL;
+  input->size = 0;
 }
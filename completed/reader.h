@@ -7,11 +7,39 @@
 #ifndef __READER_H__
 #define __READER_H__
 
+#include <stddef.h>
+
 #define IO_ERROR 0
 #define IO_SUCCESS 1
 
-int readChar(void);
-int openInputStream(char *fileName);
-void closeInputStream(void);
+// Size of the window a stream is read through
+#ifndef STREAM_BUFFER_SIZE
+#define STREAM_BUFFER_SIZE (128 * 1024)
+#endif
+
+/* A regular file is mapped with mmap and held whole in buffer. Anything
+ * else (stdin as "-", pipes, devices) is a stream: buffer is a window of
+ * STREAM_BUFFER_SIZE bytes holding the part of the input being scanned,
+ * refilled as the scanner moves on, so memory does not grow with the
+ * input. */
+typedef struct
+{
+  const unsigned char *buffer;
+  size_t size;     // bytes in buffer
+  size_t capacity; // size of the window; 0 for a mapped file
+  size_t consumed; // bytes of the stream dropped before buffer[0]
+  int mapped;
+  int fd;
+  int atEnd;       // nothing more will come after buffer[size - 1]
+  int failed;      // reading failed, so the input is cut short
+} InputStream;
+
+int openInputStream(InputStream *input, char *fileName);
+int openInputFd(InputStream *input, int fd);
+// Drops buffer[0..keep-1], moves the rest to the front and reads more
+// behind it. Fails when the input is at its end, when the window is full
+// and nothing may be dropped, or, setting failed, when reading fails.
+int refillInputStream(InputStream *input, size_t keep);
+void closeInputStream(InputStream *input);
 
 #endif
@@ -6,329 +6,523 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 
 #include "reader.h"
 #include "charcode.h"
 #include "token.h"
 #include "error.h"
+#include "skip.h"
 #include "scanner.h"
-
-extern int lineNo;
-extern int colNo;
-extern int currentChar;
+#include "intern.h"
 
 extern CharCode charCodes[];
 
 /***************************************************************/
 
-void skipBlank()
-{
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SPACE))
-    readChar();
-}
+/* getToken is driven by a DFA over character classes. The loop in
+ * findToken walks the source buffer from the current position and stops at
+ * the first character that has no transition from the current state. The
+ * state it stops in tells which token was read, or which error occurred.
+ * Blanks (a transition back to ST_START) and comments (ST_COMMENT, entered
+ * on "(*") are handed to skipBlanks and skipComment, which consume them a
+ * whole block at a time. */
+
+#define CLASS_EOF (CHAR_UNKNOWN + 1)
+#define NUM_CLASSES (CHAR_UNKNOWN + 2)
 
-void skipComment()
+enum ScanState
 {
-  int state = 0;
-  while ((currentChar != EOF) && (state < 2))
+  ST_STOP,
+  ST_START,
+  ST_COMMENT,
+  ST_IDENT,
+  ST_NUMBER,
+  ST_DOUBLE,
+  ST_BAD_NUMBER,
+  ST_PLUS,
+  ST_MINUS,
+  ST_TIMES,
+  ST_POWER,
+  ST_SLASH,
+  ST_LT,
+  ST_LE,
+  ST_GT,
+  ST_GE,
+  ST_EQ,
+  ST_EXCLAIMATION,
+  ST_NEQ,
+  ST_COMMA,
+  ST_PERIOD,
+  ST_RSEL,
+  ST_SEMICOLON,
+  ST_COLON,
+  ST_ASSIGN,
+  ST_LPAR,
+  ST_LSEL,
+  ST_RPAR,
+  ST_CHAR_OPEN,
+  ST_CHAR_BODY,
+  ST_CHAR,
+  ST_STRING,
+  ST_STRING_END,
+  ST_UNKNOWN,
+  NUM_STATES
+};
+
+#define ANY_CHAR(state)                                                   \
+  [CHAR_SPACE] = state, [CHAR_LETTER] = state, [CHAR_DIGIT] = state,      \
+  [CHAR_PLUS] = state, [CHAR_MINUS] = state, [CHAR_TIMES] = state,        \
+  [CHAR_SLASH] = state, [CHAR_LT] = state, [CHAR_GT] = state,             \
+  [CHAR_EXCLAIMATION] = state, [CHAR_EQ] = state, [CHAR_COMMA] = state,   \
+  [CHAR_PERIOD] = state, [CHAR_COLON] = state, [CHAR_SEMICOLON] = state,  \
+  [CHAR_SINGLEQUOTE] = state, [CHAR_LPAR] = state, [CHAR_RPAR] = state,   \
+  [CHAR_DOUBLEQUOTE] = state, [CHAR_UNKNOWN] = state
+
+// Missing entries are ST_STOP: the token ends before that character.
+static const unsigned char transitions[NUM_STATES][NUM_CLASSES] = {
+    [ST_START] = {
+        [CHAR_SPACE] = ST_START,
+        [CHAR_LETTER] = ST_IDENT,
+        [CHAR_DIGIT] = ST_NUMBER,
+        [CHAR_PLUS] = ST_PLUS,
+        [CHAR_MINUS] = ST_MINUS,
+        [CHAR_TIMES] = ST_TIMES,
+        [CHAR_SLASH] = ST_SLASH,
+        [CHAR_LT] = ST_LT,
+        [CHAR_GT] = ST_GT,
+        [CHAR_EXCLAIMATION] = ST_EXCLAIMATION,
+        [CHAR_EQ] = ST_EQ,
+        [CHAR_COMMA] = ST_COMMA,
+        [CHAR_PERIOD] = ST_PERIOD,
+        [CHAR_COLON] = ST_COLON,
+        [CHAR_SEMICOLON] = ST_SEMICOLON,
+        [CHAR_SINGLEQUOTE] = ST_CHAR_OPEN,
+        [CHAR_LPAR] = ST_LPAR,
+        [CHAR_RPAR] = ST_RPAR,
+        [CHAR_DOUBLEQUOTE] = ST_STRING,
+        [CHAR_UNKNOWN] = ST_UNKNOWN,
+    },
+    [ST_IDENT] = {[CHAR_LETTER] = ST_IDENT, [CHAR_DIGIT] = ST_IDENT},
+    [ST_NUMBER] = {[CHAR_DIGIT] = ST_NUMBER, [CHAR_PERIOD] = ST_DOUBLE},
+    [ST_DOUBLE] = {[CHAR_DIGIT] = ST_DOUBLE, [CHAR_PERIOD] = ST_BAD_NUMBER},
+    [ST_BAD_NUMBER] = {[CHAR_DIGIT] = ST_BAD_NUMBER, [CHAR_PERIOD] = ST_BAD_NUMBER},
+    [ST_TIMES] = {[CHAR_TIMES] = ST_POWER},
+    [ST_LT] = {[CHAR_EQ] = ST_LE},
+    [ST_GT] = {[CHAR_EQ] = ST_GE},
+    [ST_EXCLAIMATION] = {[CHAR_EQ] = ST_NEQ},
+    [ST_PERIOD] = {[CHAR_RPAR] = ST_RSEL},
+    [ST_COLON] = {[CHAR_EQ] = ST_ASSIGN},
+    [ST_LPAR] = {[CHAR_PERIOD] = ST_LSEL, [CHAR_TIMES] = ST_COMMENT},
+    [ST_CHAR_OPEN] = {ANY_CHAR(ST_CHAR_BODY)},
+    [ST_CHAR_BODY] = {[CHAR_SINGLEQUOTE] = ST_CHAR},
+    [ST_STRING] = {ANY_CHAR(ST_STRING), [CHAR_DOUBLEQUOTE] = ST_STRING_END},
+};
+
+// Token read when the DFA stops in a state; TK_NONE for error states.
+static const TokenType acceptedTokens[NUM_STATES] = {
+    [ST_IDENT] = TK_IDENT,
+    [ST_NUMBER] = TK_NUMBER,
+    [ST_DOUBLE] = TK_DOUBLE,
+    [ST_PLUS] = SB_PLUS,
+    [ST_MINUS] = SB_MINUS,
+    [ST_TIMES] = SB_TIMES,
+    [ST_POWER] = SB_POWER,
+    [ST_SLASH] = SB_SLASH,
+    [ST_LT] = SB_LT,
+    [ST_LE] = SB_LE,
+    [ST_GT] = SB_GT,
+    [ST_GE] = SB_GE,
+    [ST_EQ] = SB_EQ,
+    [ST_NEQ] = SB_NEQ,
+    [ST_COMMA] = SB_COMMA,
+    [ST_PERIOD] = SB_PERIOD,
+    [ST_RSEL] = SB_RSEL,
+    [ST_SEMICOLON] = SB_SEMICOLON,
+    [ST_COLON] = SB_COLON,
+    [ST_ASSIGN] = SB_ASSIGN,
+    [ST_LPAR] = SB_LPAR,
+    [ST_LSEL] = SB_LSEL,
+    [ST_RPAR] = SB_RPAR,
+    [ST_CHAR] = TK_CHAR,
+    [ST_STRING] = TK_STRING,
+    [ST_STRING_END] = TK_STRING,
+};
+
+// Runs the DFA from p, or picks up a comment at p when inComment is set.
+// On return *tokenStart is the first character of the token (after any
+// blanks and comments), lc holds the newlines skipped before it, and the
+// result is one past its end. A comment left open at the end is reported
+// as ST_COMMENT with *tokenStart on its first character inside "(*"; lc
+// then covers the whole comment.
+static const unsigned char *findToken(const unsigned char *p, const unsigned char *end, int inComment,
+                                      const unsigned char **tokenStart, int *finalState, LineCount *lc)
+{
+  const unsigned char *start = p;
+  int state = inComment ? ST_COMMENT : ST_START;
+  int next;
+
+  lc->lines = 0;
+  while (1)
   {
-    switch (charCodes[currentChar])
+    if (state == ST_COMMENT)
     {
-    case CHAR_TIMES:
-      state = 1;
-      break;
-    case CHAR_RPAR:
-      if (state == 1)
-        state = 2;
+      p = skipComment(start, end, lc);
+      if (p == NULL)
+      {
+        p = end;
+        break;
+      }
+      start = p;
+      state = ST_START;
+      continue;
+    }
+
+    next = transitions[state][(p < end) ? charCodes[*p] : CLASS_EOF];
+    if (next <= ST_COMMENT)
+    {
+      if (next == ST_STOP)
+        break;
+      if (next == ST_START)
+      {
+        p = skipBlanks(p, end, lc);
+        start = p;
+      }
       else
-        state = 0;
-      break;
-    default:
-      state = 0;
+      {
+        // p is on the '*' of "(*"
+        start = p + 1;
+        state = ST_COMMENT;
+      }
+      continue;
     }
-    readChar();
+    p++;
+    state = next;
   }
-  if (state != 2)
-    error(ERR_END_OF_COMMENT, lineNo, colNo);
+
+  *tokenStart = start;
+  *finalState = state;
+  return p;
 }
 
-Token *readIdentKeyword(void)
+// Moves the cursor to stop, counting the line breaks on the way.
+static void advanceTo(ScanCursor *cursor, const unsigned char *stop)
 {
-  Token *token = makeToken(TK_NONE, lineNo, colNo);
-  int count = 1;
-
-  token->string[0] = toupper((char)currentChar);
-  readChar();
+  const unsigned char *p = cursor->p;
 
-  while ((currentChar != EOF) &&
-         ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT)))
+  while ((p < stop) && ((p = memchr(p, '\n', stop - p)) != NULL))
   {
-    if (count <= MAX_IDENT_LEN)
-      token->string[count++] = toupper((char)currentChar);
-    readChar();
+    cursor->lineNo++;
+    p++;
+    cursor->lineStart = p;
   }
+  cursor->p = stop;
+}
 
-  if (count > MAX_IDENT_LEN)
-  {
-    error(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
-    return token;
-  }
-
-  token->string[count] = '\0';
-  token->tokenType = checkKeyword(token->string);
-
-  if (token->tokenType == TK_NONE)
-    token->tokenType = TK_IDENT;
-
-  return token;
+static void setError(Token *token, ErrorCode err, int lineNo, int colNo)
+{
+  token->tokenType = TK_NONE;
+  token->value = err;
+  token->lineNo = lineNo;
+  token->colNo = colNo;
 }
 
-Token *readNumber(void)
+const unsigned char *scanToken(ScanCursor *cursor, const unsigned char *end, int more, Token *token)
 {
-  Token *token = makeToken(TK_NONE, lineNo, colNo);
-  int count = 0;
-  int isDouble = 0;
+  const unsigned char *start, *stop, *p;
+  char number[64];
+  LineCount lc;
+  int state, count;
 
-  while ((currentChar != EOF) && ((charCodes[currentChar] == CHAR_DIGIT) ||
-                                  (charCodes[currentChar] == CHAR_PERIOD)))
+  if ((cursor->p >= end) && !cursor->inComment)
   {
-    token->string[count++] = (char)currentChar;
-    if (charCodes[currentChar] == CHAR_PERIOD)
-      isDouble++;
-    readChar();
+    if (more)
+      return NULL;
+    token->tokenType = TK_EOF;
+    token->lineNo = cursor->lineNo;
+    token->colNo = (end - cursor->lineStart) + 1 + cursor->pastEnd;
+    return end;
   }
 
-  token->string[count] = '\0';
-  if (isDouble == 0)
-  {
-    token->tokenType = TK_NUMBER;
-    token->value = atoi(token->string);
-  }
-  else if (isDouble == 1)
+  stop = findToken(cursor->p, end, cursor->inComment, &start, &state, &lc);
+  if (lc.lines > 0)
   {
-    token->tokenType = TK_DOUBLE;
-    token->doubleValue = atof(token->string);
+    cursor->lineNo += lc.lines;
+    cursor->lineStart = lc.lastLineStart;
   }
-  else
+
+  if (more && (stop == end))
   {
-    error(ERR_INVALID_VARIABLE, lineNo, colNo);
+    // The token may go on in the input still to come. Keep what was
+    // skipped before it, and scan it again once there is more. In an open
+    // comment only a last '*' may matter, as the start of "*)".
+    if (state == ST_COMMENT)
+    {
+      cursor->inComment = 1;
+      cursor->p = ((start < end) && (end[-1] == '*')) ? end - 1 : end;
+    }
+    else
+    {
+      cursor->inComment = 0;
+      cursor->p = start;
+    }
+    return NULL;
   }
-  return token;
-}
 
-Token *readConstChar(void)
-{
-  Token *token = makeToken(TK_CHAR, lineNo, colNo);
-
-  readChar();
-  if (currentChar == EOF)
+  cursor->inComment = 0;
+  if (state == ST_COMMENT)
   {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
+    // lc already covers the comment: report from the end of input
+    cursor->p = end;
+    setError(token, ERR_END_OF_COMMENT, cursor->lineNo, (end - cursor->lineStart) + 1);
+    return end;
   }
 
-  token->string[0] = currentChar;
-  token->string[1] = '\0';
+  cursor->p = start;
+  token->tokenType = acceptedTokens[state];
+  token->lineNo = cursor->lineNo;
+  token->colNo = (start - cursor->lineStart) + 1;
+  advanceTo(cursor, stop);
 
-  readChar();
-  if (currentChar == EOF)
+  switch (state)
   {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
+  case ST_START:
+    token->tokenType = TK_EOF;
+    return start;
+  case ST_CHAR_OPEN:
+  case ST_CHAR_BODY:
+    setError(token, ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    return start;
+  case ST_EXCLAIMATION:
+  case ST_UNKNOWN:
+    setError(token, ERR_INVALID_SYMBOL, token->lineNo, token->colNo);
+    return start;
+  case ST_BAD_NUMBER:
+    // reported on the character after the number, a line break included
+    if ((stop < end) && (*stop == '\n'))
+      setError(token, ERR_INVALID_VARIABLE, cursor->lineNo + 1, 0);
+    else
+      setError(token, ERR_INVALID_VARIABLE, cursor->lineNo, (stop - cursor->lineStart) + 1);
+    return start;
   }
 
-  if (charCodes[currentChar] == CHAR_SINGLEQUOTE)
+  token->text = (const char *)start;
+  token->length = stop - start;
+  switch (token->tokenType)
   {
-    readChar();
-    return token;
+  case TK_IDENT:
+    if (token->length > MAX_IDENT_LEN)
+    {
+      setError(token, ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
+      break;
+    }
+    token->tokenType = checkKeyword(token->text, token->length);
+    if (token->tokenType == TK_NONE)
+      token->tokenType = TK_IDENT;
+    break;
+  case TK_NUMBER:
+    token->value = 0;
+    for (p = start; p < stop; p++)
+      token->value = (unsigned)token->value * 10 + (*p - '0');
+    break;
+  case TK_DOUBLE:
+    // strtod needs a terminated string, and the source may end right
+    // after the number; digits past the precision of a double are dropped
+    count = (token->length < (int)sizeof(number)) ? token->length : (int)sizeof(number) - 1;
+    memcpy(number, start, count);
+    number[count] = '\0';
+    token->doubleValue = atof(number);
+    break;
+  case TK_CHAR:
+    token->text++;
+    token->length = 1;
+    break;
+  case TK_STRING:
+    token->text++;
+    token->length -= (state == ST_STRING_END) ? 2 : 1;
+    // an unterminated string also consumes the end of input
+    if (state == ST_STRING)
+      cursor->pastEnd++;
+    break;
+  default:
+    break;
   }
-  else
+  return start;
+}
+
+static void initScanner(ScannerContext *scanner)
+{
+  int i;
+
+  scanner->cursor.p = scanner->input.buffer;
+  scanner->cursor.lineStart = scanner->input.buffer;
+  scanner->cursor.lineNo = 1;
+  scanner->cursor.pastEnd = 0;
+  scanner->cursor.inComment = 0;
+  scanner->nextSlot = 0;
+  for (i = 0; i < TOKEN_RING_SIZE; i++)
   {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
+    scanner->ring[i].tokenType = TK_NONE;
+    scanner->spill[i] = NULL;
+    scanner->spillSize[i] = 0;
   }
+  scanner->supply = NULL;
+  scanner->readyTokens = NULL;
+  scanner->readyCount = 0;
+  scanner->readyNext = 0;
 }
-Token *readConstString(void)
+
+int openScanner(ScannerContext *scanner, char *fileName)
 {
-  Token *token = makeToken(TK_STRING, lineNo, colNo);
+  if (openInputStream(&scanner->input, fileName) == IO_ERROR)
+    return IO_ERROR;
+  initScanner(scanner);
+  return IO_SUCCESS;
+}
 
-  int count = 0;
+int openScannerFd(ScannerContext *scanner, int fd)
+{
+  if (openInputFd(&scanner->input, fd) == IO_ERROR)
+    return IO_ERROR;
+  initScanner(scanner);
+  return IO_SUCCESS;
+}
 
-  token->string[count] = (char)currentChar;
-  readChar();
+void closeScanner(ScannerContext *scanner)
+{
+  int i;
 
-  while ((currentChar != EOF) && (charCodes[currentChar] != CHAR_DOUBLEQUOTE))
-  {
-    token->string[count++] = (char)currentChar;
-    readChar();
-  }
+  useTokens(scanner, NULL);
+  for (i = 0; i < TOKEN_RING_SIZE; i++)
+    free(scanner->spill[i]);
+  closeInputStream(&scanner->input);
+}
 
-  token->string[count] = '\0';
-  // printToken(token);
-  readChar();
+void seekScanner(ScannerContext *scanner, size_t offset, int lineNo)
+{
+  const unsigned char *buffer = scanner->input.buffer;
+  const unsigned char *lineStart = buffer + offset;
+
+  while ((lineStart > buffer) && (lineStart[-1] != '\n'))
+    lineStart--;
+  scanner->cursor.p = buffer + offset;
+  scanner->cursor.lineStart = lineStart;
+  scanner->cursor.lineNo = lineNo;
+  scanner->cursor.pastEnd = 0;
+  scanner->cursor.inComment = 0;
+}
 
-  return token;
+void useTokens(ScannerContext *scanner, TokenSupply *supply)
+{
+  if (scanner->supply != NULL)
+    scanner->supply->close(scanner->supply);
+  scanner->supply = supply;
+  scanner->readyTokens = NULL;
+  scanner->readyCount = 0;
+  scanner->readyNext = 0;
 }
 
-Token *getToken(void)
+// Reads more of a stream behind the cursor. The text of the tokens in the
+// ring that lies before the cursor is about to be dropped, so it is copied
+// aside first; text after it moves along with the window.
+static int refillScanner(ScannerContext *scanner)
 {
+  InputStream *input = &scanner->input;
+  const unsigned char *buffer = input->buffer;
+  const char *text;
+  size_t keep = scanner->cursor.p - buffer;
   Token *token;
-  int ln, cn;
+  int i;
 
-  if (currentChar == EOF)
-    return makeToken(TK_EOF, lineNo, colNo);
+  if ((keep == 0) && (input->size == input->capacity))
+    return IO_ERROR;
 
-  switch (charCodes[currentChar])
+  for (i = 0; i < TOKEN_RING_SIZE; i++)
   {
-  case CHAR_SPACE:
-    skipBlank();
-    return getToken();
-  case CHAR_LETTER:
-    return readIdentKeyword();
-  case CHAR_DIGIT:
-    return readNumber();
-  case CHAR_PLUS:
-    token = makeToken(SB_PLUS, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_MINUS:
-    token = makeToken(SB_MINUS, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_TIMES:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_TIMES))
+    token = &scanner->ring[i];
+    text = token->text;
+    if ((token->tokenType == TK_NONE) || (token->tokenType == TK_EOF) ||
+        ((const unsigned char *)text < buffer) || ((const unsigned char *)text >= buffer + input->size))
+      continue;
+    if ((const unsigned char *)text < scanner->cursor.p)
     {
-      readChar();
-      return makeToken(SB_POWER, ln, cn);
+      if (scanner->spillSize[i] < token->length)
+      {
+        scanner->spillSize[i] = token->length;
+        scanner->spill[i] = (char *)realloc(scanner->spill[i], token->length);
+      }
+      memcpy(scanner->spill[i], text, token->length);
+      token->text = scanner->spill[i];
     }
     else
-      return makeToken(SB_TIMES, ln, cn);
-  case CHAR_SLASH:
-    token = makeToken(SB_SLASH, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_LT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_LE, ln, cn);
-    }
-    else
-      return makeToken(SB_LT, ln, cn);
-  case CHAR_GT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_GE, ln, cn);
-    }
-    else
-      return makeToken(SB_GT, ln, cn);
-  case CHAR_EQ:
-    token = makeToken(SB_EQ, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_EXCLAIMATION:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_NEQ, ln, cn);
-    }
-    else
-    {
-      token = makeToken(TK_NONE, ln, cn);
-      error(ERR_INVALID_SYMBOL, ln, cn);
-      return token;
-    }
-  case CHAR_COMMA:
-    token = makeToken(SB_COMMA, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_PERIOD:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_RPAR))
-    {
-      readChar();
-      return makeToken(SB_RSEL, ln, cn);
-    }
-    else
-      return makeToken(SB_PERIOD, ln, cn);
-  case CHAR_SEMICOLON:
-    token = makeToken(SB_SEMICOLON, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_COLON:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
+      token->text -= keep;
+  }
+
+  if (refillInputStream(input, keep) == IO_ERROR)
+    return IO_ERROR;
+  scanner->cursor.p -= keep;
+  scanner->cursor.lineStart -= keep;
+  return IO_SUCCESS;
+}
+
+// Tokens are handed out from a small ring in the context instead of the
+// heap. A token stays valid until TOKEN_RING_SIZE more tokens have been
+// read, which is plenty for the parser's currentToken and lookAhead. A
+// supply's tokens are copied into the ring too, so its batches can go as
+// soon as they are read.
+Token *getToken(ScannerContext *scanner)
+{
+  Token *token;
+  int more;
+
+  token = &scanner->ring[scanner->nextSlot];
+  scanner->nextSlot = (scanner->nextSlot + 1) % TOKEN_RING_SIZE;
+  if (scanner->supply != NULL)
+  {
+    if (scanner->readyNext == scanner->readyCount)
     {
-      readChar();
-      return makeToken(SB_ASSIGN, ln, cn);
+      scanner->readyTokens = scanner->supply->next(scanner->supply, &scanner->readyCount);
+      scanner->readyNext = 0;
     }
-    else
-      return makeToken(SB_COLON, ln, cn);
-  case CHAR_SINGLEQUOTE:
-    return readConstChar();
-  case CHAR_DOUBLEQUOTE:
-    return readConstString();
-  case CHAR_LPAR:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-
-    if (currentChar == EOF)
-      return makeToken(SB_LPAR, ln, cn);
-
-    switch (charCodes[currentChar])
+    // the last token is TK_EOF or an error, and is handed out repeatedly
+    *token = scanner->readyTokens[scanner->readyNext];
+    if ((token->tokenType != TK_EOF) && (token->tokenType != TK_NONE))
+      scanner->readyNext++;
+  }
+  else
+  {
+    token->tokenType = TK_NONE;
+    more = !scanner->input.atEnd;
+    while (scanToken(&scanner->cursor, scanner->input.buffer + scanner->input.size, more, token) == NULL)
     {
-    case CHAR_PERIOD:
-      readChar();
-      return makeToken(SB_LSEL, ln, cn);
-    case CHAR_TIMES:
-      readChar();
-      skipComment();
-      return getToken();
-    default:
-      return makeToken(SB_LPAR, ln, cn);
+      if (refillScanner(scanner) == IO_ERROR)
+      {
+        if (scanner->input.failed)
+          error(ERR_READ_FAILED, scanner->cursor.lineNo, (scanner->cursor.p - scanner->cursor.lineStart) + 1);
+        // the window is full of one token: take as much as there is
+        more = 0;
+        scanToken(&scanner->cursor, scanner->input.buffer + scanner->input.size, more, token);
+        if ((token->tokenType != TK_NONE) && (scanner->cursor.p == scanner->input.buffer + scanner->input.size))
+          setError(token, ERR_CONSTANT_TOO_LONG, token->lineNo, token->colNo);
+        break;
+      }
+      more = !scanner->input.atEnd;
     }
-  case CHAR_RPAR:
-    token = makeToken(SB_RPAR, lineNo, colNo);
-    readChar();
-    return token;
-  default:
-    token = makeToken(TK_NONE, lineNo, colNo);
-    error(ERR_INVALID_SYMBOL, lineNo, colNo);
-    readChar();
-    return token;
   }
+
+  if (token->tokenType == TK_IDENT)
+    token->name = internName(token->text, token->length);
+  else if (token->tokenType == TK_NONE)
+    error(token->value, token->lineNo, token->colNo);
+  return token;
 }
 
-Token *getValidToken(void)
+Token *getValidToken(ScannerContext *scanner)
 {
-  Token *token = getToken();
+  Token *token = getToken(scanner);
   while (token->tokenType == TK_NONE)
-  {
-    free(token);
-    token = getToken();
-  }
+    token = getToken(scanner);
   return token;
 }
 
@@ -336,7 +530,6 @@ Token *getValidToken(void)
 
 void printToken(Token *token)
 {
-
   printf("%d-%d:", token->lineNo, token->colNo);
 
   switch (token->tokenType)
@@ -345,19 +538,19 @@ void printToken(Token *token)
     printf("TK_NONE\n");
     break;
   case TK_IDENT:
-    printf("TK_IDENT(%s)\n", token->string);
+    printf("TK_IDENT(%s)\n", token->name);
     break;
   case TK_NUMBER:
-    printf("TK_NUMBER(%s)\n", token->string);
+    printf("TK_NUMBER(%.*s)\n", token->length, token->text);
     break;
   case TK_CHAR:
-    printf("TK_CHAR(\'%s\')\n", token->string);
+    printf("TK_CHAR(\'%.*s\')\n", token->length, token->text);
     break;
   case TK_DOUBLE:
-    printf("TK_DOUBLE(%s)\n", token->string);
+    printf("TK_DOUBLE(%.*s)\n", token->length, token->text);
     break;
   case TK_STRING:
-    printf("TK_STRING(\'%s\')\n", token->string);
+    printf("TK_STRING(\'%.*s\')\n", token->length, token->text);
     break;
   case TK_EOF:
     printf("TK_EOF\n");
@@ -7,10 +7,66 @@
 #ifndef __SCANNER_H__
 #define __SCANNER_H__
 
+#include "reader.h"
 #include "token.h"
 
-Token* getToken(void);
-Token* getValidToken(void);
+// Where scanning stands: the next character and the line it is on.
+typedef struct
+{
+  const unsigned char *p;
+  const unsigned char *lineStart;
+  int lineNo;
+  int pastEnd;   // characters consumed after the end of input
+  int inComment; // p is inside a comment (a stream stopped in it)
+} ScanCursor;
+
+// Reads the token at the cursor without touching any global state, so it
+// can run on several parts of the input at once. Errors are not reported:
+// the token comes back as TK_NONE with the ErrorCode in value, at the
+// position the error belongs to. Returns where the token starts.
+// When more is set, end is only where the input read so far stops: a
+// token reaching it is not taken, the cursor moves past the blanks and
+// comments before it, and the result is NULL.
+const unsigned char *scanToken(ScanCursor *cursor, const unsigned char *end, int more, Token *token);
+
+/* Tokens scanned by someone else, such as the threads of lexInParallel
+ * (plex.h). next hands out the following batch, of at least one token,
+ * which stays valid until the next call; the last batch ends at TK_EOF or
+ * at an error, and next is not called again. close releases everything. */
+typedef struct TokenSupply
+{
+  Token *(*next)(struct TokenSupply *supply, int *count);
+  void (*close)(struct TokenSupply *supply);
+} TokenSupply;
+
+/* Everything one scan of one source needs. Nothing in the scanner is
+ * shared, so each compilation can own a context and run on its own thread. */
+typedef struct
+{
+  InputStream input;
+  ScanCursor cursor;
+  Token ring[TOKEN_RING_SIZE]; // see getToken
+  int nextSlot;
+  char *spill[TOKEN_RING_SIZE]; // ring token text that left a stream's window
+  int spillSize[TOKEN_RING_SIZE];
+  TokenSupply *supply;         // see useTokens
+  Token *readyTokens;          // the supply's batch being handed out
+  int readyCount;
+  int readyNext;
+} ScannerContext;
+
+int openScanner(ScannerContext *scanner, char *fileName);
+int openScannerFd(ScannerContext *scanner, int fd);
+void closeScanner(ScannerContext *scanner);
+// Moves the scanner of an input held whole in buffer to buffer[offset],
+// which is on line lineNo and between tokens, outside any comment.
+void seekScanner(ScannerContext *scanner, size_t offset, int lineNo);
+// Makes getToken hand out the supply's tokens instead of scanning, closing
+// the supply it had. NULL goes back to scanning.
+void useTokens(ScannerContext *scanner, TokenSupply *supply);
+
+Token* getToken(ScannerContext *scanner);
+Token* getValidToken(ScannerContext *scanner);
 void printToken(Token *token);
 
 #endif
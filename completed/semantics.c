@@ -9,34 +9,25 @@
 #include "semantics.h"
 #include "error.h"
 
-extern SymTab *symtab;
-extern Token *currentToken;
+extern __thread SymTab *symtab;
+extern __thread Token *currentToken;
 
-Object *lookupObject(char *name)
+Object *lookupObject(const char *name)
 {
-  Scope *scope = symtab->currentScope;
-  Object *obj;
-
-  while (scope != NULL)
-  {
-    obj = findObject(scope->objList, name);
-    if (obj != NULL)
-      return obj;
-    scope = scope->outer;
-  }
-  obj = findObject(symtab->globalObjectList, name);
-  if (obj != NULL)
-    return obj;
-  return NULL;
+  if (countingStats)
+    symtab->stats.lookups++;
+  return findVisibleObject(name);
 }
 
-void checkFreshIdent(char *name)
+void checkFreshIdent(const char *name)
 {
-  if (findObject(symtab->currentScope->objList, name) != NULL)
+  if (countingStats)
+    symtab->stats.freshChecks++;
+  if (findLocalObject(name) != NULL)
     error(ERR_DUPLICATE_IDENT, currentToken->lineNo, currentToken->colNo);
 }
 
-Object *checkDeclaredIdent(char *name)
+Object *checkDeclaredIdent(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -46,7 +37,7 @@ Object *checkDeclaredIdent(char *name)
   return obj;
 }
 
-Object *checkDeclaredConstant(char *name)
+Object *checkDeclaredConstant(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -57,7 +48,7 @@ Object *checkDeclaredConstant(char *name)
   return obj;
 }
 
-Object *checkDeclaredType(char *name)
+Object *checkDeclaredType(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -68,7 +59,7 @@ Object *checkDeclaredType(char *name)
   return obj;
 }
 
-Object *checkDeclaredVariable(char *name)
+Object *checkDeclaredVariable(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -79,7 +70,7 @@ Object *checkDeclaredVariable(char *name)
   return obj;
 }
 
-Object *checkDeclaredFunction(char *name)
+Object *checkDeclaredFunction(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -90,7 +81,7 @@ Object *checkDeclaredFunction(char *name)
   return obj;
 }
 
-Object *checkDeclaredProcedure(char *name)
+Object *checkDeclaredProcedure(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -101,7 +92,7 @@ Object *checkDeclaredProcedure(char *name)
   return obj;
 }
 
-Object *checkDeclaredLValueIdent(char *name)
+Object *checkDeclaredLValueIdent(const char *name)
 {
   Object *obj = lookupObject(name);
   if (obj == NULL)
@@ -161,6 +152,15 @@ void checkAssignType(Type *type)
     error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
 }
 
+// What -, *, / and ** take: strings may only be joined with +
+void checkNumberType(Type *type)
+{
+  if ((type != NULL) && ((type->typeClass == TP_INT) || (type->typeClass == TP_CHAR) || (type->typeClass == TP_DOUBLE)))
+    return;
+  else
+    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+}
+
 void checkArrayType(Type *type)
 {
   if ((type != NULL) && (type->typeClass == TP_ARRAY))
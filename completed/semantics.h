@@ -9,14 +9,14 @@
 
 #include "symtab.h"
 
-void checkFreshIdent(char *name);
-Object *checkDeclaredIdent(char *name);
-Object *checkDeclaredConstant(char *name);
-Object *checkDeclaredType(char *name);
-Object *checkDeclaredVariable(char *name);
-Object *checkDeclaredFunction(char *name);
-Object *checkDeclaredProcedure(char *name);
-Object *checkDeclaredLValueIdent(char *name);
+void checkFreshIdent(const char *name);
+Object *checkDeclaredIdent(const char *name);
+Object *checkDeclaredConstant(const char *name);
+Object *checkDeclaredType(const char *name);
+Object *checkDeclaredVariable(const char *name);
+Object *checkDeclaredFunction(const char *name);
+Object *checkDeclaredProcedure(const char *name);
+Object *checkDeclaredLValueIdent(const char *name);
 
 void checkIntType(Type *type);
 void checkCharType(Type *type);
@@ -25,6 +25,7 @@ void checkBasicType(Type *type);
 void checkStringType(Type *type);
 void checkAssignType(Type *type);
 void checkDoubleType(Type *type);
+void checkNumberType(Type *type);
 
 void checkTypeEquality(Type *type1, Type *type2);
 
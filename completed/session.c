@@ -0,0 +1,240 @@
+/* Incremental checking
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "session.h"
+#include "intern.h"
+
+extern __thread SymTab *symtab;
+
+// Units dropped or checked again leave their objects behind in the symbol
+// table's arena. Once it holds this many times what a full check takes,
+// the next check is a full one, which starts from an empty arena.
+#define GARBAGE_LIMIT 3
+
+CheckSession *openSession(void)
+{
+  return (CheckSession *)calloc(1, sizeof(CheckSession));
+}
+
+static void freeUnits(CheckedUnit *units, int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    freeDependencies(&units[i].dependencies);
+}
+
+void closeSession(CheckSession *session)
+{
+  freeUnits(session->units, session->unitCount);
+  freeUnits(session->newUnits, session->newUnitCount);
+  free(session->units);
+  free(session->newUnits);
+  free(session->text);
+  if (symtab != NULL)
+  {
+    cleanSymTab();
+    freeNames();
+  }
+  free(session);
+}
+
+static int countLines(const unsigned char *p, const unsigned char *end)
+{
+  int lines = 0;
+
+  while ((p < end) && ((p = memchr(p, '\n', end - p)) != NULL))
+  {
+    lines++;
+    p++;
+  }
+  return lines;
+}
+
+int beginEdit(CheckSession *session, const InputStream *input)
+{
+  const unsigned char *oldText = session->text;
+  const unsigned char *newText = input->buffer;
+  size_t common = (input->size < session->size) ? input->size : session->size;
+  size_t prefix = 0, suffix = 0;
+
+  session->incremental = 0;
+  // a stream is not held whole, so it cannot be compared or skipped in
+  if (!session->valid || !input->atEnd || (input->consumed > 0) ||
+      (symtabMemory() > GARBAGE_LIMIT * session->fullMemory))
+    return 0;
+
+  while ((prefix < common) && (oldText[prefix] == newText[prefix]))
+    prefix++;
+  if (prefix < session->headerEnd)
+    return 0;
+  while ((suffix < common - prefix) &&
+         (oldText[session->size - 1 - suffix] == newText[input->size - 1 - suffix]))
+    suffix++;
+
+  session->incremental = 1;
+  session->prefix = prefix;
+  session->suffix = suffix;
+  session->delta = (long)input->size - (long)session->size;
+  session->lineDelta = countLines(newText + prefix, newText + input->size - suffix) -
+                       countLines(oldText + prefix, oldText + session->size - suffix);
+  session->nextUnit = 0;
+  session->newUnitCount = 0;
+  return 1;
+}
+
+void beginFullCheck(CheckSession *session)
+{
+  freeUnits(session->units, session->unitCount);
+  freeUnits(session->newUnits, session->newUnitCount);
+  session->unitCount = 0;
+  session->newUnitCount = 0;
+  session->incremental = 0;
+  if (symtab != NULL)
+  {
+    cleanSymTab();
+    freeNames();
+  }
+  initSymTab();
+}
+
+// The body runs to the end of the text, which the scanner reads on past
+// its '.'
+static size_t textEnd(CheckSession *session, CheckedUnit *unit)
+{
+  return (unit->object == NULL) ? session->size : unit->end;
+}
+
+// Where an old unit's text is in the new version, if the edit left it alone
+static int unitMoved(CheckSession *session, CheckedUnit *unit, size_t *start)
+{
+  if (textEnd(session, unit) <= session->prefix)
+    *start = unit->start;
+  else if (unit->start >= session->size - session->suffix)
+    *start = unit->start + session->delta;
+  else
+    return 0;
+  return 1;
+}
+
+static int stillValid(CheckedUnit *unit)
+{
+  DependencyList *list = &unit->dependencies;
+  Object *obj;
+  int i;
+
+  if ((unit->object != NULL) && (findLocalObject(unit->object->name) != NULL))
+    return 0;
+  for (i = 0; i < list->count; i++)
+  {
+    obj = findVisibleObject(list->items[i].name);
+    if (obj != list->items[i].object)
+    {
+      if ((obj == NULL) || !sameDeclaration(list->items[i].object, obj))
+        return 0;
+      list->items[i].object = obj;
+    }
+  }
+  return 1;
+}
+
+CheckedUnit *findReusableUnit(CheckSession *session, size_t offset)
+{
+  CheckedUnit *unit;
+  size_t start;
+
+  if (!session->incremental)
+    return NULL;
+  // the units left alone keep their order, so those starting before
+  // offset are behind for good, like the ones the edit touched
+  while (session->nextUnit < session->unitCount)
+  {
+    unit = &session->units[session->nextUnit];
+    if (!unitMoved(session, unit, &start) || (start < offset))
+    {
+      session->nextUnit++;
+      continue;
+    }
+    if (start > offset)
+      return NULL;
+    session->nextUnit++;
+    return stillValid(unit) ? unit : NULL;
+  }
+  return NULL;
+}
+
+static CheckedUnit *nextUnit(CheckSession *session)
+{
+  if (session->newUnitCount == session->newUnitCapacity)
+  {
+    session->newUnitCapacity = (session->newUnitCapacity == 0) ? 16 : session->newUnitCapacity * 2;
+    session->newUnits = (CheckedUnit *)realloc(session->newUnits, session->newUnitCapacity * sizeof(CheckedUnit));
+  }
+  return &session->newUnits[session->newUnitCount++];
+}
+
+CheckedUnit *reuseUnit(CheckSession *session, CheckedUnit *unit, size_t start)
+{
+  CheckedUnit *reused = nextUnit(session);
+
+  *reused = *unit;
+  if (textEnd(session, unit) > session->prefix)
+  {
+    reused->start = start;
+    reused->end += session->delta;
+    reused->endLineNo += session->lineDelta;
+  }
+  // the dependencies now belong to the new unit
+  memset(&unit->dependencies, 0, sizeof(DependencyList));
+  session->unitsReused++;
+  return reused;
+}
+
+CheckedUnit *addUnit(CheckSession *session, size_t start)
+{
+  CheckedUnit *unit = nextUnit(session);
+
+  unit->object = NULL;
+  unit->start = start;
+  unit->end = start;
+  unit->endLineNo = 0;
+  memset(&unit->dependencies, 0, sizeof(DependencyList));
+  session->unitsChecked++;
+  return unit;
+}
+
+void endCheck(CheckSession *session, const InputStream *input, int succeeded)
+{
+  CheckedUnit *units = session->units;
+  int capacity = session->newUnitCapacity;
+
+  symtab->dependencies = NULL;
+  session->valid = succeeded;
+  if (!succeeded)
+  {
+    freeUnits(session->newUnits, session->newUnitCount);
+    session->newUnitCount = 0;
+    return;
+  }
+
+  // the new units replace the old, whose arrays swap places
+  freeUnits(session->units, session->unitCount);
+  session->units = session->newUnits;
+  session->unitCount = session->newUnitCount;
+  session->newUnits = units;
+  session->newUnitCapacity = session->unitCapacity;
+  session->unitCapacity = capacity;
+  session->newUnitCount = 0;
+
+  session->text = (unsigned char *)realloc(session->text, input->size);
+  memcpy(session->text, input->buffer, input->size);
+  session->size = input->size;
+  if (!session->incremental)
+    session->fullMemory = symtabMemory();
+}
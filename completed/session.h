@@ -0,0 +1,92 @@
+/* Incremental checking
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stddef.h>
+
+#include "reader.h"
+#include "symtab.h"
+
+/* A check session compiles one version of a program after another, as an
+ * editor does while the program is typed, and keeps the symbol table from
+ * one check to the next. The program's heading and the declarations before
+ * its first procedure or function make the header. Each top-level
+ * procedure and function, and the body, is a unit that remembers where its
+ * text was and the outer names it used (see DependencyList).
+ *
+ * When a new version leaves the header alone, a unit whose text did not
+ * change and whose names still find the same declarations is not checked
+ * again: its Object is declared as it is, with the scopes under it, and
+ * the scanner jumps over its text. The units the edit touched, and those
+ * using a procedure or function whose parameters or result changed, are
+ * compiled as usual. Any other edit, or one after a failed check, means
+ * checking everything.
+ *
+ * Only the text compiled is listed, so a check that reuses units prints
+ * fewer tokens than compile() would; the symbol table printed at the end
+ * is the same. A session uses its thread's symbol table and names until
+ * it is closed, so the thread runs nothing else in between. */
+
+typedef struct
+{
+  Object *object; // NULL for the body
+  size_t start;   // the unit's text: from the end of the one before it
+  size_t end;     // past its last ';', or at the '.' after the body
+  int endLineNo;
+  DependencyList dependencies;
+} CheckedUnit;
+
+typedef struct
+{
+  int valid;              // the last check succeeded
+  unsigned char *text;    // the version it checked
+  size_t size;
+  size_t headerEnd;       // past the header's last ';'
+  int headerLineNo;
+  int headerCount;        // the objects the header declares
+  CheckedUnit *units;     // in the order of the text
+  int unitCount;
+  int unitCapacity;
+  size_t fullMemory;      // symtabMemory() after the last full check
+
+  // the edit being checked: the text outside [prefix, size - suffix) is
+  // the same in both versions, and moves by delta bytes and lineDelta lines
+  int incremental;
+  size_t prefix;
+  size_t suffix;
+  long delta;
+  int lineDelta;
+  int nextUnit;           // the first old unit that might still be reused
+  CheckedUnit *newUnits;
+  int newUnitCount;
+  int newUnitCapacity;
+
+  long unitsChecked;      // over the whole session
+  long unitsReused;
+} CheckSession;
+
+CheckSession *openSession(void);
+void closeSession(CheckSession *session);
+// Checks fileName as the next version of the session's program; the
+// result is that of compile(). Defined in parser.c.
+int recheck(CheckSession *session, char *fileName);
+
+// For recheck: whether the new version in input can be checked from the
+// session's symbol table; if not, beginFullCheck starts a fresh one.
+int beginEdit(CheckSession *session, const InputStream *input);
+void beginFullCheck(CheckSession *session);
+// The old unit that would start at offset in the new version, if its text
+// is unchanged and every name it used still finds an equal declaration
+CheckedUnit *findReusableUnit(CheckSession *session, size_t offset);
+// Takes over an old unit found above as the next unit, moved to start
+CheckedUnit *reuseUnit(CheckSession *session, CheckedUnit *unit, size_t start);
+// Starts a new unit at start, to be compiled
+CheckedUnit *addUnit(CheckSession *session, size_t start);
+void endCheck(CheckSession *session, const InputStream *input, int succeeded);
+
+#endif
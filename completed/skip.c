@@ -0,0 +1,235 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* Blank and comment skipping for the scanner. On x86 the blocks are
+ * examined 16 (SSE2) or 32 (AVX2) bytes at a time, chosen on the first
+ * call from what the CPU supports; elsewhere, and for the last partial
+ * block, the plain loops are used. Newlines are counted per block with a
+ * popcount of the newline mask. */
+
+#include <stddef.h>
+#include "charcode.h"
+#include "skip.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SKIP_SIMD
+#include <immintrin.h>
+#endif
+
+extern CharCode charCodes[];
+
+static const unsigned char *skipBlanksScalar(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  while ((p < end) && (charCodes[*p] == CHAR_SPACE))
+  {
+    if (*p == '\n')
+    {
+      lc->lines++;
+      lc->lastLineStart = p + 1;
+    }
+    p++;
+  }
+  return p;
+}
+
+static const unsigned char *skipCommentScalar(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  for (; p < end; p++)
+  {
+    if ((*p == '*') && (p + 1 < end) && (p[1] == ')'))
+      return p + 2;
+    if (*p == '\n')
+    {
+      lc->lines++;
+      lc->lastLineStart = p + 1;
+    }
+  }
+  return NULL;
+}
+
+#ifdef SKIP_SIMD
+
+// newlines is a bit mask of the newline positions in the block at p
+static inline void countLines(LineCount *lc, const unsigned char *p, unsigned newlines)
+{
+  if (newlines != 0)
+  {
+    lc->lines += __builtin_popcount(newlines);
+    lc->lastLineStart = p + (31 - __builtin_clz(newlines)) + 1;
+  }
+}
+
+// Bits below n (n < 32)
+#define BELOW(n) ((1u << (n)) - 1)
+
+// The blanks are ' ' and '\t'..'\r', as in charCodes: v - 9, saturated
+// down by 4, is zero exactly for the control characters.
+__attribute__((target("sse2"))) static const unsigned char *skipBlanksSSE2(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i four = _mm_set1_epi8(4);
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i zero = _mm_setzero_si128();
+
+  while (end - p >= 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i control = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(v, tab), four), zero);
+    unsigned blanks = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, space), control));
+    unsigned newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+
+    if (blanks != 0xFFFF)
+    {
+      int n = __builtin_ctz(~blanks);
+      countLines(lc, p, newlines & BELOW(n));
+      return p + n;
+    }
+    countLines(lc, p, newlines);
+    p += 16;
+  }
+  return skipBlanksScalar(p, end, lc);
+}
+
+__attribute__((target("sse2"))) static const unsigned char *skipCommentSSE2(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i rpar = _mm_set1_epi8(')');
+  const __m128i newline = _mm_set1_epi8('\n');
+
+  // each block also reads the byte after it, to see "*)" across blocks
+  while (end - p >= 17)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i next = _mm_loadu_si128((const __m128i *)(p + 1));
+    unsigned closes = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(next, rpar)));
+    unsigned newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+
+    if (closes != 0)
+    {
+      int n = __builtin_ctz(closes);
+      countLines(lc, p, newlines & BELOW(n));
+      return p + n + 2;
+    }
+    countLines(lc, p, newlines);
+    p += 16;
+  }
+  return skipCommentScalar(p, end, lc);
+}
+
+__attribute__((target("avx2"))) static const unsigned char *skipBlanksAVX2(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i four = _mm256_set1_epi8(4);
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i zero = _mm256_setzero_si256();
+
+  while (end - p >= 32)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i control = _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(v, tab), four), zero);
+    unsigned blanks = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), control));
+    unsigned newlines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+
+    if (blanks != 0xFFFFFFFFu)
+    {
+      int n = __builtin_ctz(~blanks);
+      countLines(lc, p, newlines & BELOW(n));
+      return p + n;
+    }
+    countLines(lc, p, newlines);
+    p += 32;
+  }
+  return skipBlanksSSE2(p, end, lc);
+}
+
+__attribute__((target("avx2"))) static const unsigned char *skipCommentAVX2(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i rpar = _mm256_set1_epi8(')');
+  const __m256i newline = _mm256_set1_epi8('\n');
+
+  while (end - p >= 33)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i next = _mm256_loadu_si256((const __m256i *)(p + 1));
+    unsigned closes = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v, star), _mm256_cmpeq_epi8(next, rpar)));
+    unsigned newlines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+
+    if (closes != 0)
+    {
+      int n = __builtin_ctz(closes);
+      countLines(lc, p, newlines & BELOW(n));
+      return p + n + 2;
+    }
+    countLines(lc, p, newlines);
+    p += 32;
+  }
+  return skipCommentSSE2(p, end, lc);
+}
+
+#endif
+
+typedef const unsigned char *(*SkipFunction)(const unsigned char *p, const unsigned char *end, LineCount *lc);
+
+static const unsigned char *chooseSkipBlanks(const unsigned char *p, const unsigned char *end, LineCount *lc);
+static const unsigned char *chooseSkipComment(const unsigned char *p, const unsigned char *end, LineCount *lc);
+
+// Both start at a function that picks the implementation, stores it and
+// forwards the call, so the CPU is only inspected once. Scanners on other
+// threads may race to store it; they all store the same value, and the
+// pointers are read and written atomically so that is harmless.
+static SkipFunction skipBlanksImpl = chooseSkipBlanks;
+static SkipFunction skipCommentImpl = chooseSkipComment;
+
+static void chooseImplementation(void)
+{
+  SkipFunction blanks, comment;
+
+#ifdef SKIP_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    blanks = skipBlanksAVX2;
+    comment = skipCommentAVX2;
+  }
+  else if (__builtin_cpu_supports("sse2"))
+  {
+    blanks = skipBlanksSSE2;
+    comment = skipCommentSSE2;
+  }
+  else
+#endif
+  {
+    blanks = skipBlanksScalar;
+    comment = skipCommentScalar;
+  }
+  __atomic_store_n(&skipBlanksImpl, blanks, __ATOMIC_RELAXED);
+  __atomic_store_n(&skipCommentImpl, comment, __ATOMIC_RELAXED);
+}
+
+static const unsigned char *chooseSkipBlanks(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  chooseImplementation();
+  return skipBlanks(p, end, lc);
+}
+
+static const unsigned char *chooseSkipComment(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  chooseImplementation();
+  return skipComment(p, end, lc);
+}
+
+const unsigned char *skipBlanks(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  return __atomic_load_n(&skipBlanksImpl, __ATOMIC_RELAXED)(p, end, lc);
+}
+
+const unsigned char *skipComment(const unsigned char *p, const unsigned char *end, LineCount *lc)
+{
+  return __atomic_load_n(&skipCommentImpl, __ATOMIC_RELAXED)(p, end, lc);
+}
@@ -0,0 +1,24 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __SKIP_H__
+#define __SKIP_H__
+
+// Newlines crossed while skipping, so the caller can keep its line number
+// without looking at the skipped bytes again.
+typedef struct
+{
+  int lines;
+  const unsigned char *lastLineStart; // just after the last newline seen
+} LineCount;
+
+// Returns the first non-blank character at or after p, or end.
+const unsigned char *skipBlanks(const unsigned char *p, const unsigned char *end, LineCount *lc);
+// p is just inside "(*". Returns the character after the closing "*)",
+// or NULL when the comment runs to end.
+const unsigned char *skipComment(const unsigned char *p, const unsigned char *end, LineCount *lc);
+
+#endif
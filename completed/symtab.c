@@ -7,332 +7,759 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include "arena.h"
 #include "symtab.h"
 #include "error.h"
 
-void freeObject(Object *obj);
-void freeScope(Scope *scope);
-void freeObjectList(ObjectNode *objList);
-void freeReferenceList(ObjectNode *objList);
+// One symbol table per compilation thread
+__thread SymTab *symtab;
 
-SymTab *symtab;
-Type *intType;
-Type *charType;
-Type *doubleType;
-Type *stringType;
+/* Types are interned: each distinct type exists once, so types compare
+ * by pointer and are never copied or freed on their own. The basic types
+ * are shared by every compilation; array types are made on demand, by
+ * size and element type, and belong to the compilation's symbol table. */
+static Type basicTypes[] = {
+  [TP_INT] = {TP_INT, 0, NULL},
+  [TP_CHAR] = {TP_CHAR, 0, NULL},
+  [TP_DOUBLE] = {TP_DOUBLE, 0, NULL},
+  [TP_STRING] = {TP_STRING, 0, NULL}};
+
+Type *intType = &basicTypes[TP_INT];
+Type *charType = &basicTypes[TP_CHAR];
+Type *doubleType = &basicTypes[TP_DOUBLE];
+Type *stringType = &basicTypes[TP_STRING];
+
+/* Everything the symbol table holds (objects, scopes, types, constants)
+ * lives as long as the compilation, so it all comes from one arena that
+ * cleanSymTab releases in one go. */
+static __thread Arena symtabArena;
+
+__thread int countingStats = 0;
+
+static void *allocate(size_t size, enum AllocCategory category)
+{
+  if (countingStats)
+    symtab->stats.bytes[category] += size;
+  return arenaAlloc(&symtabArena, size);
+}
+
+#define NEW(type, category) ((type *)allocate(sizeof(type), category))
 
 /******************* Type utilities ******************************/
 
 Type *makeIntType(void)
 {
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_INT;
-  return type;
+  return intType;
 }
 
 Type *makeCharType(void)
 {
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_CHAR;
-  return type;
+  return charType;
 }
 Type *makeDoubleType(void)
 {
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_DOUBLE;
-  return type;
+  return doubleType;
 }
 Type *makeStringType(void)
 {
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_STRING;
-  return type;
+  return stringType;
 }
 
-Type *makeArrayType(int arraySize, Type *elementType)
+// The array types are kept in an open-addressing table, at most half full
+#define INITIAL_TYPE_TABLE_SIZE 16
+
+static unsigned hashArrayType(int arraySize, Type *elementType)
+{
+  uintptr_t key = (uintptr_t)elementType ^ ((uintptr_t)(unsigned)arraySize << 3);
+  return (unsigned)((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static Type **probeArrayType(Type **table, int size, int arraySize, Type *elementType)
 {
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_ARRAY;
-  type->arraySize = arraySize;
-  type->elementType = elementType;
-  return type;
+  unsigned i = hashArrayType(arraySize, elementType) & (size - 1);
+
+  while ((table[i] != NULL) && ((table[i]->arraySize != arraySize) || (table[i]->elementType != elementType)))
+    i = (i + 1) & (size - 1);
+  return &table[i];
+}
+
+static void growArrayTypes(void)
+{
+  int size = (symtab->arrayTypesSize == 0) ? INITIAL_TYPE_TABLE_SIZE : symtab->arrayTypesSize * 2;
+  Type **table = (Type **)calloc(size, sizeof(Type *));
+  int i;
+
+  for (i = 0; i < symtab->arrayTypesSize; i++)
+    if (symtab->arrayTypes[i] != NULL)
+      *probeArrayType(table, size, symtab->arrayTypes[i]->arraySize, symtab->arrayTypes[i]->elementType) = symtab->arrayTypes[i];
+  free(symtab->arrayTypes);
+  symtab->arrayTypes = table;
+  symtab->arrayTypesSize = size;
 }
 
-Type *duplicateType(Type *type)
+Type *makeArrayType(int arraySize, Type *elementType)
 {
-  Type *resultType = (Type *)malloc(sizeof(Type));
-  resultType->typeClass = type->typeClass;
-  if (type->typeClass == TP_ARRAY)
+  Type **slot;
+
+  if (2 * (symtab->arrayTypeCount + 1) > symtab->arrayTypesSize)
+    growArrayTypes();
+  slot = probeArrayType(symtab->arrayTypes, symtab->arrayTypesSize, arraySize, elementType);
+  if (*slot == NULL)
   {
-    resultType->arraySize = type->arraySize;
-    resultType->elementType = duplicateType(type->elementType);
+    Type *type = NEW(Type, ALLOC_TYPE);
+    type->typeClass = TP_ARRAY;
+    type->arraySize = arraySize;
+    type->elementType = elementType;
+    *slot = type;
+    symtab->arrayTypeCount++;
   }
-  return resultType;
+  return *slot;
 }
 
 int compareType(Type *type1, Type *type2)
 {
-  if (type1->typeClass == type2->typeClass)
-  {
-    if (type1->typeClass == TP_ARRAY)
-    {
-      if (type1->arraySize == type2->arraySize)
-        return compareType(type1->elementType, type2->elementType);
-      else
-        return 0;
-    }
-    else
-      return 1;
-  }
-  else if ((type1->typeClass == TP_DOUBLE && type2->typeClass == TP_INT) || (type2->typeClass == TP_DOUBLE && type1->typeClass == TP_INT))
-  {
+  if (type1 == type2)
+    return 1;
+  // distinct arrays still match if their elements differ only in int/double
+  if ((type1->typeClass == TP_ARRAY) && (type2->typeClass == TP_ARRAY))
+    return (type1->arraySize == type2->arraySize) && compareType(type1->elementType, type2->elementType);
+  if ((type1->typeClass == TP_DOUBLE && type2->typeClass == TP_INT) || (type2->typeClass == TP_DOUBLE && type1->typeClass == TP_INT))
     return 1;
-  }
-
   return 0;
 }
 
-void freeType(Type *type)
+/******************* Constant utility ******************************/
+
+// The pool's slots are kept at most half full
+#define INITIAL_CONSTANT_SLOTS 64
+
+// A string is hashed and compared by its first length characters, so that
+// it can be looked up straight from the source text
+static unsigned hashConstant(const ConstantValue *value, int length)
 {
-  switch (type->typeClass)
+  uint64_t key = 0;
+  int i;
+
+  switch (value->type)
   {
   case TP_INT:
+    key = (uint32_t)value->intValue;
+    break;
   case TP_CHAR:
+    key = (unsigned char)value->charValue;
+    break;
   case TP_DOUBLE:
+    memcpy(&key, &value->doubleValue, sizeof(key));
+    break;
   case TP_STRING:
-    free(type);
+    key = 14695981039346656037ull;
+    for (i = 0; i < length; i++)
+      key = (key ^ (unsigned char)value->stringValue[i]) * 1099511628211ull;
     break;
-  case TP_ARRAY:
-    freeType(type->elementType);
-    freeType(type);
+  default:
     break;
   }
+  key = (key ^ value->type) * 0x9E3779B97F4A7C15ull;
+  return (unsigned)(key >> 32);
 }
 
-/******************* Constant utility ******************************/
+// Doubles compare by their bits, so 0.0 and -0.0 stay apart
+static int sameConstant(const ConstantValue *v1, const ConstantValue *v2, int length)
+{
+  if (v1->type != v2->type)
+    return 0;
+  switch (v1->type)
+  {
+  case TP_INT:
+    return v1->intValue == v2->intValue;
+  case TP_CHAR:
+    return v1->charValue == v2->charValue;
+  case TP_DOUBLE:
+    return memcmp(&v1->doubleValue, &v2->doubleValue, sizeof(double)) == 0;
+  case TP_STRING:
+    return (strncmp(v1->stringValue, v2->stringValue, length) == 0) && (v1->stringValue[length] == '\0');
+  default:
+    return 0;
+  }
+}
 
-ConstantValue *makeIntConstant(int i)
+static ConstantId *probeConstant(ConstantPool *pool, ConstantId *slots, int slotCount,
+                                 const ConstantValue *value, int length)
 {
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_INT;
-  value->intValue = i;
-  return value;
+  unsigned i = hashConstant(value, length) & (slotCount - 1);
+
+  while ((slots[i] != 0) && !sameConstant(&pool->values[slots[i] - 1], value, length))
+    i = (i + 1) & (slotCount - 1);
+  return &slots[i];
 }
 
-ConstantValue *makeCharConstant(char ch)
+static void growConstantSlots(ConstantPool *pool)
 {
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_CHAR;
-  value->charValue = ch;
-  return value;
+  int slotCount = (pool->slotCount == 0) ? INITIAL_CONSTANT_SLOTS : pool->slotCount * 2;
+  ConstantId *slots = (ConstantId *)calloc(slotCount, sizeof(ConstantId));
+  ConstantValue *value;
+  ConstantId id;
+
+  for (id = 0; id < pool->count; id++)
+  {
+    value = &pool->values[id];
+    *probeConstant(pool, slots, slotCount, value, (value->type == TP_STRING) ? strlen(value->stringValue) : 0) = id + 1;
+  }
+  free(pool->slots);
+  pool->slots = slots;
+  pool->slotCount = slotCount;
 }
-ConstantValue *makeDoubleConstant(double db)
+
+// The id of value, adding it to the pool if need be. A string is given as
+// length characters of the source text, copied into the arena if new.
+static ConstantId poolConstant(ConstantValue *value, int length)
 {
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_DOUBLE;
-  value->doubleValue = db;
-  return value;
+  ConstantPool *pool = &symtab->constants;
+  ConstantId *slot;
+
+  if (countingStats)
+    symtab->stats.constants++;
+  if (2 * (pool->count + 1) > pool->slotCount)
+    growConstantSlots(pool);
+  slot = probeConstant(pool, pool->slots, pool->slotCount, value, length);
+  if (*slot == 0)
+  {
+    if (pool->count == pool->capacity)
+    {
+      pool->capacity = (pool->capacity == 0) ? INITIAL_CONSTANT_SLOTS / 2 : pool->capacity * 2;
+      pool->values = (ConstantValue *)realloc(pool->values, pool->capacity * sizeof(ConstantValue));
+    }
+    if (value->type == TP_STRING)
+      value->stringValue = arenaCopy(&symtabArena, value->stringValue, length);
+    if (countingStats && (value->type == TP_STRING))
+      symtab->stats.bytes[ALLOC_CONSTANT] += length + 1;
+    pool->values[pool->count] = *value;
+    *slot = ++pool->count;
+  }
+  return *slot - 1;
+}
+
+static void freeConstantPool(ConstantPool *pool)
+{
+  free(pool->values);
+  free(pool->slots);
+}
+
+ConstantId makeIntConstant(int i)
+{
+  ConstantValue value;
+  value.type = TP_INT;
+  value.intValue = i;
+  return poolConstant(&value, 0);
+}
+
+ConstantId makeCharConstant(char ch)
+{
+  ConstantValue value;
+  value.type = TP_CHAR;
+  value.charValue = ch;
+  return poolConstant(&value, 0);
+}
+ConstantId makeDoubleConstant(double db)
+{
+  ConstantValue value;
+  value.type = TP_DOUBLE;
+  value.doubleValue = db;
+  return poolConstant(&value, 0);
+}
+ConstantId makeStringConstant(const char *str, int length)
+{
+  ConstantValue value;
+  value.type = TP_STRING;
+  value.stringValue = str;
+  return poolConstant(&value, length);
 }
-ConstantValue *makeStringConstant(char *str)
+
+ConstantId negateConstant(ConstantId id)
 {
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_STRING;
-  value->stringValue = strdup(str);
-  return value;
+  ConstantValue *value = constantValue(id);
+
+  if (value->type == TP_INT)
+    return makeIntConstant(-value->intValue);
+  if (value->type == TP_DOUBLE)
+    return makeDoubleConstant(-value->doubleValue);
+  return id;
 }
 
-ConstantValue *duplicateConstantValue(ConstantValue *v)
+ConstantValue *constantValue(ConstantId id)
 {
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = v->type;
-  if (v->type == TP_INT)
-    value->intValue = v->intValue;
-  else if (v->type == TP_CHAR)
-    value->charValue = v->charValue;
-  else if (v->type == TP_STRING)
-    value->stringValue = strdup(v->stringValue);
-  else if (v->type == TP_DOUBLE)
-    value->doubleValue = v->doubleValue;
-  return value;
+  return &symtab->constants.values[id];
 }
 
 /******************* Object utilities ******************************/
 
 Scope *createScope(Object *owner, Scope *outer)
 {
-  Scope *scope = (Scope *)malloc(sizeof(Scope));
-  scope->objList = NULL;
+  Scope *scope = NEW(Scope, ALLOC_SCOPE);
+
+  if (countingStats)
+    symtab->stats.scopes++;
+  scope->objects = NULL;
+  scope->objectCount = 0;
+  scope->capacity = 0;
   scope->owner = owner;
   scope->outer = outer;
   return scope;
 }
 
-Object *createProgramObject(char *programName)
+#define INITIAL_OBJECT_TABLE_SIZE 256
+
+static void growObjectTable(ObjectTable *table)
 {
-  Object *program = (Object *)malloc(sizeof(Object));
-  strcpy(program->name, programName);
-  program->kind = OBJ_PROGRAM;
-  program->progAttrs = (ProgramAttributes *)malloc(sizeof(ProgramAttributes));
+  int capacity = (table->capacity == 0) ? INITIAL_OBJECT_TABLE_SIZE : table->capacity * 2;
+
+  table->objects = (Object **)realloc(table->objects, capacity * sizeof(Object *));
+  table->kinds = (unsigned char *)realloc(table->kinds, capacity * sizeof(unsigned char));
+  table->names = (const char **)realloc(table->names, capacity * sizeof(const char *));
+  table->types = (Type **)realloc(table->types, capacity * sizeof(Type *));
+  table->scopes = (Scope **)realloc(table->scopes, capacity * sizeof(Scope *));
+  table->capacity = capacity;
+}
+
+static void freeObjectTable(ObjectTable *table)
+{
+  free(table->objects);
+  free(table->kinds);
+  free(table->names);
+  free(table->types);
+  free(table->scopes);
+}
+
+// An object and its attributes are allocated together
+static Object *newObject(const char *name, enum ObjectKind kind, size_t attrsSize)
+{
+  ObjectTable *table = &symtab->objects;
+  Object *obj = (Object *)allocate(sizeof(Object) + attrsSize, ALLOC_OBJECT);
+  ObjectId id;
+
+  if (table->count == table->capacity)
+    growObjectTable(table);
+  id = table->count++;
+  table->objects[id] = obj;
+  table->kinds[id] = kind;
+  table->names[id] = name;
+  table->types[id] = NULL;
+  table->scopes[id] = NULL;
+
+  if (countingStats)
+    symtab->stats.objects[kind]++;
+  obj->name = name;
+  obj->id = id;
+  obj->kind = kind;
+  obj->attrs = obj + 1;
+  return obj;
+}
+
+Object *createProgramObject(const char *programName)
+{
+  Object *program = newObject(programName, OBJ_PROGRAM, sizeof(ProgramAttributes));
   program->progAttrs->scope = createScope(program, NULL);
   symtab->program = program;
 
   return program;
 }
 
-Object *createConstantObject(char *name)
+Object *createConstantObject(const char *name)
 {
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_CONSTANT;
-  obj->constAttrs = (ConstantAttributes *)malloc(sizeof(ConstantAttributes));
-  return obj;
+  return newObject(name, OBJ_CONSTANT, sizeof(ConstantAttributes));
 }
 
-Object *createTypeObject(char *name)
+Object *createTypeObject(const char *name)
 {
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_TYPE;
-  obj->typeAttrs = (TypeAttributes *)malloc(sizeof(TypeAttributes));
-  return obj;
+  return newObject(name, OBJ_TYPE, 0);
 }
 
-Object *createVariableObject(char *name)
+Object *createVariableObject(const char *name)
 {
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_VARIABLE;
-  obj->varAttrs = (VariableAttributes *)malloc(sizeof(VariableAttributes));
+  Object *obj = newObject(name, OBJ_VARIABLE, sizeof(VariableAttributes));
   obj->varAttrs->scope = symtab->currentScope;
   return obj;
 }
 
-Object *createFunctionObject(char *name)
+Object *createFunctionObject(const char *name)
 {
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_FUNCTION;
-  obj->funcAttrs = (FunctionAttributes *)malloc(sizeof(FunctionAttributes));
-  obj->funcAttrs->paramList = NULL;
+  Object *obj = newObject(name, OBJ_FUNCTION, sizeof(FunctionAttributes));
+  obj->funcAttrs->paramCount = 0;
   obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
   return obj;
 }
 
-Object *createProcedureObject(char *name)
+Object *createProcedureObject(const char *name)
 {
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PROCEDURE;
-  obj->procAttrs = (ProcedureAttributes *)malloc(sizeof(ProcedureAttributes));
-  obj->procAttrs->paramList = NULL;
+  Object *obj = newObject(name, OBJ_PROCEDURE, sizeof(ProcedureAttributes));
+  obj->procAttrs->paramCount = 0;
   obj->procAttrs->scope = createScope(obj, symtab->currentScope);
   return obj;
 }
 
-Object *createParameterObject(char *name, enum ParamKind kind, Object *owner)
+Object *createParameterObject(const char *name, enum ParamKind kind, Object *owner)
 {
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PARAMETER;
-  obj->paramAttrs = (ParameterAttributes *)malloc(sizeof(ParameterAttributes));
+  Object *obj = newObject(name, OBJ_PARAMETER, sizeof(ParameterAttributes));
   obj->paramAttrs->kind = kind;
   obj->paramAttrs->function = owner;
   return obj;
 }
 
-void freeObject(Object *obj)
+Type *objectType(Object *obj)
+{
+  return symtab->objects.types[obj->id];
+}
+
+void setObjectType(Object *obj, Type *type)
 {
-  switch (obj->kind)
+  symtab->objects.types[obj->id] = type;
+}
+
+Object *scopeObject(Scope *scope, int i)
+{
+  return symtab->objects.objects[scope->objects[i]];
+}
+
+int countParams(Object *obj)
+{
+  return (obj->kind == OBJ_FUNCTION) ? obj->funcAttrs->paramCount : obj->procAttrs->paramCount;
+}
+
+Object *getParam(Object *obj, int i)
+{
+  return scopeObject((obj->kind == OBJ_FUNCTION) ? obj->funcAttrs->scope : obj->procAttrs->scope, i);
+}
+
+Object *findObject(Scope *scope, const char *name)
+{
+  ObjectTable *table = &symtab->objects;
+  int i;
+
+  for (i = 0; i < scope->objectCount; i++)
+    if (table->names[scope->objects[i]] == name)
+      return table->objects[scope->objects[i]];
+  return NULL;
+}
+
+/* The display is an open-addressing table with linear probing, kept at
+ * most half full. Names are interned, so it hashes and compares the
+ * pointers. A name keeps its slot when its last binding is popped. */
+
+#define INITIAL_DISPLAY_SIZE 64
+
+static unsigned hashName(const char *name)
+{
+  return (unsigned)(((uintptr_t)name * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static DisplayEntry *probeDisplay(DisplayEntry *display, int size, const char *name)
+{
+  unsigned i = hashName(name) & (size - 1);
+
+  while ((display[i].name != NULL) && (display[i].name != name))
+    i = (i + 1) & (size - 1);
+  return &display[i];
+}
+
+static void growDisplay(void)
+{
+  int size = (symtab->displaySize == 0) ? INITIAL_DISPLAY_SIZE : symtab->displaySize * 2;
+  DisplayEntry *display = (DisplayEntry *)calloc(size, sizeof(DisplayEntry));
+  int i;
+
+  for (i = 0; i < symtab->displaySize; i++)
+    if (symtab->display[i].name != NULL)
+      *probeDisplay(display, size, symtab->display[i].name) = symtab->display[i];
+  free(symtab->display);
+  symtab->display = display;
+  symtab->displaySize = size;
+}
+
+static void bindObject(Object *obj)
+{
+  DisplayEntry *entry;
+
+  if (2 * (symtab->displayCount + 1) > symtab->displaySize)
+    growDisplay();
+  entry = probeDisplay(symtab->display, symtab->displaySize, obj->name);
+  if (entry->name == NULL)
   {
-  case OBJ_CONSTANT:
-    free(obj->constAttrs->value);
-    free(obj->constAttrs);
-    break;
-  case OBJ_TYPE:
-    free(obj->typeAttrs->actualType);
-    free(obj->typeAttrs);
-    break;
-  case OBJ_VARIABLE:
-    free(obj->varAttrs->type);
-    free(obj->varAttrs);
-    break;
-  case OBJ_FUNCTION:
-    freeReferenceList(obj->funcAttrs->paramList);
-    freeType(obj->funcAttrs->returnType);
-    freeScope(obj->funcAttrs->scope);
-    free(obj->funcAttrs);
-    break;
-  case OBJ_PROCEDURE:
-    freeReferenceList(obj->procAttrs->paramList);
-    freeScope(obj->procAttrs->scope);
-    free(obj->procAttrs);
-    break;
-  case OBJ_PROGRAM:
-    freeScope(obj->progAttrs->scope);
-    free(obj->progAttrs);
-    break;
-  case OBJ_PARAMETER:
-    freeType(obj->paramAttrs->type);
-    free(obj->paramAttrs);
+    entry->name = obj->name;
+    symtab->displayCount++;
   }
-  free(obj);
+
+  if (entry->top.object != NULL)
+  {
+    Binding *shadowed = NEW(Binding, ALLOC_BINDING);
+    *shadowed = entry->top;
+    entry->top.shadowed = shadowed;
+  }
+  entry->top.object = obj;
+  entry->top.depth = symtab->depth;
 }
 
-void freeScope(Scope *scope)
+static void unbindName(const char *name)
 {
-  freeObjectList(scope->objList);
-  free(scope);
+  DisplayEntry *entry = probeDisplay(symtab->display, symtab->displaySize, name);
+  Binding *shadowed = entry->top.shadowed;
+
+  if (shadowed != NULL)
+    entry->top = *shadowed; // the arena keeps the old binding until the end
+  else
+    entry->top.object = NULL;
+}
+
+// Adds the number of slots probed to *steps, unless steps is NULL
+static Binding *findBinding(const char *name, long *steps)
+{
+  DisplayEntry *entry;
+  unsigned mask = symtab->displaySize - 1;
+
+  if (symtab->displaySize == 0)
+    return NULL;
+  entry = probeDisplay(symtab->display, symtab->displaySize, name);
+  if (steps != NULL)
+    *steps += (((unsigned)(entry - symtab->display) - hashName(name)) & mask) + 1;
+  return &entry->top;
+}
+
+static Object *findBuiltinObject(const char *name);
+
+static void recordDependency(DependencyList *list, const char *name, Object *obj);
+
+Object *findVisibleObject(const char *name)
+{
+  Binding *binding = findBinding(name, countingStats ? &symtab->stats.lookupSteps : NULL);
+  Object *obj;
+
+  if ((binding != NULL) && (binding->object != NULL))
+  {
+    if ((symtab->dependencies != NULL) && (binding->depth <= 1))
+      recordDependency(symtab->dependencies, name, binding->object);
+    return binding->object;
+  }
+  obj = findBuiltinObject(name);
+  if ((symtab->dependencies != NULL) && (obj != NULL))
+    recordDependency(symtab->dependencies, name, obj);
+  return obj;
 }
 
-void freeObjectList(ObjectNode *objList)
+Object *findLocalObject(const char *name)
 {
-  ObjectNode *list = objList;
+  Binding *binding = findBinding(name, NULL);
+
+  return ((binding != NULL) && (binding->depth == symtab->depth)) ? binding->object : NULL;
+}
+
+#define INITIAL_SCOPE_SIZE 4
 
-  while (list != NULL)
+// The ids outgrow their array by moving to one twice the size; the arena
+// keeps the old one, so at most as much again is wasted.
+static void addScopeObject(Scope *scope, ObjectId id)
+{
+  if (scope->objectCount == scope->capacity)
   {
-    ObjectNode *node = list;
-    list = list->next;
-    freeObject(node->object);
-    free(node);
+    int capacity = (scope->capacity == 0) ? INITIAL_SCOPE_SIZE : scope->capacity * 2;
+    ObjectId *objects = (ObjectId *)allocate(capacity * sizeof(ObjectId), ALLOC_LIST);
+
+    if (scope->objectCount > 0)
+      memcpy(objects, scope->objects, scope->objectCount * sizeof(ObjectId));
+    scope->objects = objects;
+    scope->capacity = capacity;
   }
+  scope->objects[scope->objectCount++] = id;
+}
+
+/******************* Dependencies ******************************/
+
+static int compareDependencies(const void *d1, const void *d2)
+{
+  uintptr_t name1 = (uintptr_t)((const Dependency *)d1)->name;
+  uintptr_t name2 = (uintptr_t)((const Dependency *)d2)->name;
+
+  return (name1 > name2) - (name1 < name2);
 }
 
-void freeReferenceList(ObjectNode *objList)
+// Sorts the list by name and keeps one item per name. A name finds the
+// same object everywhere in a unit, since a unit declares nothing at depth 1.
+static void compactDependencies(DependencyList *list)
 {
-  ObjectNode *list = objList;
+  int i, count = 0;
 
-  while (list != NULL)
+  if (list->count > 1)
+    qsort(list->items, list->count, sizeof(Dependency), compareDependencies);
+  for (i = 0; i < list->count; i++)
+    if ((count == 0) || (list->items[count - 1].name != list->items[i].name))
+      list->items[count++] = list->items[i];
+  list->count = count;
+}
+
+static void recordDependency(DependencyList *list, const char *name, Object *obj)
+{
+  // a name tends to be used several times in a row
+  if ((list->count > 0) && (list->items[list->count - 1].name == name))
+    return;
+  if (list->count == list->capacity)
   {
-    ObjectNode *node = list;
-    list = list->next;
-    free(node);
+    // compacting first keeps a long body that uses few names small
+    compactDependencies(list);
+    if (2 * list->count >= list->capacity)
+    {
+      list->capacity = (list->capacity == 0) ? 16 : list->capacity * 2;
+      list->items = (Dependency *)realloc(list->items, list->capacity * sizeof(Dependency));
+    }
   }
+  list->items[list->count].name = name;
+  list->items[list->count].object = obj;
+  list->count++;
 }
 
-void addObject(ObjectNode **objList, Object *obj)
+void finishDependencies(DependencyList *list, Object *owner)
 {
-  ObjectNode *node = (ObjectNode *)malloc(sizeof(ObjectNode));
-  node->object = obj;
-  node->next = NULL;
-  if ((*objList) == NULL)
-    *objList = node;
-  else
+  int i, count = 0;
+
+  compactDependencies(list);
+  for (i = 0; i < list->count; i++)
+    if (list->items[i].object != owner)
+      list->items[count++] = list->items[i];
+  list->count = count;
+}
+
+void freeDependencies(DependencyList *list)
+{
+  free(list->items);
+  list->items = NULL;
+  list->count = 0;
+  list->capacity = 0;
+}
+
+int sameDeclaration(Object *obj1, Object *obj2)
+{
+  Object *param1, *param2;
+  int i;
+
+  if (obj1 == obj2)
+    return 1;
+  if ((obj1->kind != obj2->kind) || ((obj1->kind != OBJ_FUNCTION) && (obj1->kind != OBJ_PROCEDURE)))
+    return 0;
+
+  // types are interned, so they compare by pointer
+  if ((objectType(obj1) != objectType(obj2)) || (countParams(obj1) != countParams(obj2)))
+    return 0;
+  for (i = 0; i < countParams(obj1); i++)
+  {
+    param1 = getParam(obj1, i);
+    param2 = getParam(obj2, i);
+    if ((param1->paramAttrs->kind != param2->paramAttrs->kind) || (objectType(param1) != objectType(param2)))
+      return 0;
+  }
+  return 1;
+}
+
+/******************* Built-in objects ******************************/
+
+/* The built-in functions and procedures are the same in every
+ * compilation, so they are laid out here at compile time and shared,
+ * read-only, by all of them; a compilation only copies their entries into
+ * the first slots of its object table. They sit below the program's scope:
+ * a name the display does not know is looked for here. Their names are
+ * not interned, so they are found by spelling. */
+
+static Object readc, readi, writei, writec, writeln, writed, writes;
+
+static Scope readcScope = {NULL, 0, 0, &readc, NULL};
+static FunctionAttributes readcAttrs = {0, &readcScope};
+static Object readc = {"READC", READC_ID, OBJ_FUNCTION, {.funcAttrs = &readcAttrs}};
+
+static Scope readiScope = {NULL, 0, 0, &readi, NULL};
+static FunctionAttributes readiAttrs = {0, &readiScope};
+static Object readi = {"READI", READI_ID, OBJ_FUNCTION, {.funcAttrs = &readiAttrs}};
+
+static ParameterAttributes writeiParamAttrs = {PARAM_VALUE, &writei};
+static Object writeiParam = {"i", WRITEI_PARAM_ID, OBJ_PARAMETER, {.paramAttrs = &writeiParamAttrs}};
+static ObjectId writeiParams[] = {WRITEI_PARAM_ID};
+static Scope writeiScope = {writeiParams, 1, 1, &writei, NULL};
+static ProcedureAttributes writeiAttrs = {1, &writeiScope};
+static Object writei = {"WRITEI", WRITEI_ID, OBJ_PROCEDURE, {.procAttrs = &writeiAttrs}};
+
+static ParameterAttributes writecParamAttrs = {PARAM_VALUE, &writec};
+static Object writecParam = {"ch", WRITEC_PARAM_ID, OBJ_PARAMETER, {.paramAttrs = &writecParamAttrs}};
+static ObjectId writecParams[] = {WRITEC_PARAM_ID};
+static Scope writecScope = {writecParams, 1, 1, &writec, NULL};
+static ProcedureAttributes writecAttrs = {1, &writecScope};
+static Object writec = {"WRITEC", WRITEC_ID, OBJ_PROCEDURE, {.procAttrs = &writecAttrs}};
+
+static Scope writelnScope = {NULL, 0, 0, &writeln, NULL};
+static ProcedureAttributes writelnAttrs = {0, &writelnScope};
+static Object writeln = {"WRITELN", WRITELN_ID, OBJ_PROCEDURE, {.procAttrs = &writelnAttrs}};
+
+static ParameterAttributes writedParamAttrs = {PARAM_VALUE, &writed};
+static Object writedParam = {"d", WRITED_PARAM_ID, OBJ_PARAMETER, {.paramAttrs = &writedParamAttrs}};
+static ObjectId writedParams[] = {WRITED_PARAM_ID};
+static Scope writedScope = {writedParams, 1, 1, &writed, NULL};
+static ProcedureAttributes writedAttrs = {1, &writedScope};
+static Object writed = {"WRITED", WRITED_ID, OBJ_PROCEDURE, {.procAttrs = &writedAttrs}};
+
+static ParameterAttributes writesParamAttrs = {PARAM_VALUE, &writes};
+static Object writesParam = {"s", WRITES_PARAM_ID, OBJ_PARAMETER, {.paramAttrs = &writesParamAttrs}};
+static ObjectId writesParams[] = {WRITES_PARAM_ID};
+static Scope writesScope = {writesParams, 1, 1, &writes, NULL};
+static ProcedureAttributes writesAttrs = {1, &writesScope};
+static Object writes = {"WRITES", WRITES_ID, OBJ_PROCEDURE, {.procAttrs = &writesAttrs}};
+
+// Their entries in every object table, by id
+static Object *const builtinObjects[NUM_OF_BUILTIN_IDS] = {
+    &readc, &readi, &writei, &writeiParam, &writec, &writecParam,
+    &writeln, &writed, &writedParam, &writes, &writesParam};
+static Type *const builtinTypes[NUM_OF_BUILTIN_IDS] = {
+    [READC_ID] = &basicTypes[TP_CHAR],
+    [READI_ID] = &basicTypes[TP_INT],
+    [WRITEI_PARAM_ID] = &basicTypes[TP_INT],
+    [WRITEC_PARAM_ID] = &basicTypes[TP_CHAR],
+    [WRITED_PARAM_ID] = &basicTypes[TP_DOUBLE],
+    [WRITES_PARAM_ID] = &basicTypes[TP_STRING]};
+static Scope *const builtinScopes[NUM_OF_BUILTIN_IDS] = {
+    [WRITEI_PARAM_ID] = &writeiScope,
+    [WRITEC_PARAM_ID] = &writecScope,
+    [WRITED_PARAM_ID] = &writedScope,
+    [WRITES_PARAM_ID] = &writesScope};
+
+static void addBuiltinObjects(ObjectTable *table)
+{
+  int i;
+
+  for (i = 0; i < NUM_OF_BUILTIN_IDS; i++)
   {
-    ObjectNode *n = *objList;
-    while (n->next != NULL)
-      n = n->next;
-    n->next = node;
+    if (table->count == table->capacity)
+      growObjectTable(table);
+    table->objects[i] = builtinObjects[i];
+    table->kinds[i] = builtinObjects[i]->kind;
+    table->names[i] = builtinObjects[i]->name;
+    table->types[i] = builtinTypes[i];
+    table->scopes[i] = builtinScopes[i];
+    table->count++;
   }
 }
 
-Object *findObject(ObjectNode *objList, char *name)
+static Object *const builtins[] = {&readc, &readi, &writei, &writec, &writeln, &writed, &writes};
+
+#define NUM_OF_BUILTINS (int)(sizeof(builtins) / sizeof(builtins[0]))
+
+static Object *findBuiltinObject(const char *name)
 {
-  while (objList != NULL)
+  int i;
+
+  for (i = 0; i < NUM_OF_BUILTINS; i++)
   {
-    if (strcmp(objList->object->name, name) == 0)
-      return objList->object;
-    else
-      objList = objList->next;
+    if (countingStats)
+      symtab->stats.lookupSteps++;
+    if (strcmp(builtins[i]->name, name) == 0)
+    {
+      if (countingStats)
+        symtab->stats.builtinLookups++;
+      return builtins[i];
+    }
   }
   return NULL;
 }
@@ -341,88 +768,82 @@ Object *findObject(ObjectNode *objList, char *name)
 
 void initSymTab(void)
 {
-  Object *obj;
-  Object *param;
-
-  symtab = (SymTab *)malloc(sizeof(SymTab));
-  symtab->globalObjectList = NULL;
-
-  obj = createFunctionObject("READC");
-  obj->funcAttrs->returnType = makeCharType();
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createFunctionObject("READI");
-  obj->funcAttrs->returnType = makeIntType();
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITEI");
-  param = createParameterObject("i", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeIntType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITEC");
-  param = createParameterObject("ch", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeCharType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITELN");
-  addObject(&(symtab->globalObjectList), obj);
-  obj = createProcedureObject("WRITED");
-  param = createParameterObject("d", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeDoubleType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITES");
-  param = createParameterObject("s", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeStringType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  intType = makeIntType();
-  charType = makeCharType();
-  doubleType = makeDoubleType();
-  stringType = makeStringType();
+  symtab = (SymTab *)arenaAlloc(&symtabArena, sizeof(SymTab));
+  symtab->program = NULL;
+  symtab->currentScope = NULL;
+  symtab->depth = 0;
+  symtab->display = NULL;
+  symtab->displaySize = 0;
+  symtab->displayCount = 0;
+  symtab->arrayTypes = NULL;
+  symtab->arrayTypesSize = 0;
+  symtab->arrayTypeCount = 0;
+  memset(&symtab->objects, 0, sizeof(ObjectTable));
+  addBuiltinObjects(&symtab->objects);
+  memset(&symtab->constants, 0, sizeof(ConstantPool));
+  memset(&symtab->stats, 0, sizeof(SymTabStats));
+  symtab->dependencies = NULL;
 }
 
 void cleanSymTab(void)
 {
-  freeObject(symtab->program);
-  freeObjectList(symtab->globalObjectList);
-  free(symtab);
-  freeType(intType);
-  freeType(charType);
+  free(symtab->display);
+  free(symtab->arrayTypes);
+  freeObjectTable(&symtab->objects);
+  freeConstantPool(&symtab->constants);
+  freeArena(&symtabArena);
+  symtab = NULL;
 }
 
 void enterBlock(Scope *scope)
 {
   symtab->currentScope = scope;
+  symtab->depth++;
+  if (countingStats && (symtab->depth > symtab->stats.maxDepth))
+    symtab->stats.maxDepth = symtab->depth;
+}
+
+void reopenBlock(Scope *scope, int count)
+{
+  int i;
+
+  scope->objectCount = count;
+  enterBlock(scope);
+  for (i = 0; i < count; i++)
+    bindObject(scopeObject(scope, i));
 }
 
 void exitBlock(void)
 {
-  symtab->currentScope = symtab->currentScope->outer;
+  Scope *scope = symtab->currentScope;
+  const char **names = symtab->objects.names;
+  int i;
+
+  for (i = 0; i < scope->objectCount; i++)
+    unbindName(names[scope->objects[i]]);
+  symtab->currentScope = scope->outer;
+  symtab->depth--;
 }
 
 void declareObject(Object *obj)
 {
+  Scope *scope = symtab->currentScope;
+
+  // parameters come first in their scope, so they are its first objects
   if (obj->kind == OBJ_PARAMETER)
   {
-    Object *owner = symtab->currentScope->owner;
-    switch (owner->kind)
-    {
-    case OBJ_FUNCTION:
-      addObject(&(owner->funcAttrs->paramList), obj);
-      break;
-    case OBJ_PROCEDURE:
-      addObject(&(owner->procAttrs->paramList), obj);
-      break;
-    default:
-      break;
-    }
+    if (scope->owner->kind == OBJ_FUNCTION)
+      scope->owner->funcAttrs->paramCount++;
+    else if (scope->owner->kind == OBJ_PROCEDURE)
+      scope->owner->procAttrs->paramCount++;
   }
 
-  addObject(&(symtab->currentScope->objList), obj);
+  symtab->objects.scopes[obj->id] = scope;
+  addScopeObject(scope, obj->id);
+  bindObject(obj);
+}
+
+size_t symtabMemory(void)
+{
+  return symtabArena.used;
 }
@@ -35,6 +35,8 @@ enum ParamKind
   PARAM_REFERENCE
 };
 
+// Types are interned and shared: never modify one, and compare them with
+// compareType or by pointer.
 struct Type_
 {
   enum TypeClass typeClass;
@@ -53,42 +55,56 @@ struct ConstantValue_
     int intValue;
     char charValue;
     double doubleValue;
-    char *stringValue;
+    const char *stringValue;
   };
 };
 
 typedef struct ConstantValue_ ConstantValue;
 
+// A value's index in its symbol table's ConstantPool
+typedef int ConstantId;
+
+/* Constant values are pooled: each distinct value is kept once, however
+ * many constants have it, and is referred to by its ConstantId. A constant
+ * declared as another one shares its value. Values are never modified;
+ * the text of strings lives in the symbol table's arena. */
+struct ConstantPool_
+{
+  ConstantValue *values; // by ConstantId
+  int count;
+  int capacity;
+  ConstantId *slots;     // open addressing, by value: ids plus one, 0 when free
+  int slotCount;
+};
+
+typedef struct ConstantPool_ ConstantPool;
+
 struct Scope_;
-struct ObjectNode_;
 struct Object_;
 
+// An object's index in its symbol table's ObjectTable
+typedef int ObjectId;
+
 struct ConstantAttributes_
 {
-  ConstantValue *value;
+  ConstantId value;
 };
 
 struct VariableAttributes_
 {
-  Type *type;
   struct Scope_ *scope;
 };
 
-struct TypeAttributes_
-{
-  Type *actualType;
-};
-
+// The parameters are the first paramCount objects of the scope
 struct ProcedureAttributes_
 {
-  struct ObjectNode_ *paramList;
+  int paramCount;
   struct Scope_ *scope;
 };
 
 struct FunctionAttributes_
 {
-  struct ObjectNode_ *paramList;
-  Type *returnType;
+  int paramCount;
   struct Scope_ *scope;
 };
 
@@ -100,27 +116,28 @@ struct ProgramAttributes_
 struct ParameterAttributes_
 {
   enum ParamKind kind;
-  Type *type;
   struct Object_ *function;
 };
 
 typedef struct ConstantAttributes_ ConstantAttributes;
-typedef struct TypeAttributes_ TypeAttributes;
 typedef struct VariableAttributes_ VariableAttributes;
 typedef struct FunctionAttributes_ FunctionAttributes;
 typedef struct ProcedureAttributes_ ProcedureAttributes;
 typedef struct ProgramAttributes_ ProgramAttributes;
 typedef struct ParameterAttributes_ ParameterAttributes;
 
+// An object's type is kept in the ObjectTable: see objectType. A type
+// object has no attributes besides.
 struct Object_
 {
-  char name[MAX_IDENT_LEN];
+  const char *name; // interned (see intern.h), but for the built-ins
+  ObjectId id;
   enum ObjectKind kind;
   union
   {
+    void *attrs; // allocated right after the object
     ConstantAttributes *constAttrs;
     VariableAttributes *varAttrs;
-    TypeAttributes *typeAttrs;
     FunctionAttributes *funcAttrs;
     ProcedureAttributes *procAttrs;
     ProgramAttributes *progAttrs;
@@ -130,28 +147,143 @@ struct Object_
 
 typedef struct Object_ Object;
 
-struct ObjectNode_
+struct Scope_
+{
+  ObjectId *objects; // what it declares, in order, as printScope shows them
+  int objectCount;
+  int capacity;
+  Object *owner;
+  struct Scope_ *outer;
+};
+
+typedef struct Scope_ Scope;
+
+/* Every object is numbered as it is created, and what the compiler asks
+ * of objects most often is kept in arrays indexed by that ObjectId, so
+ * that walking a scope, or checking kinds and types, reads a few dense
+ * arrays instead of visiting each Object. The Object itself keeps the
+ * rest: constant values, parameter kinds and the scopes of blocks. The
+ * built-ins take the first ids of every table. */
+struct ObjectTable_
+{
+  Object **objects;
+  unsigned char *kinds; // enum ObjectKind
+  const char **names;
+  Type **types;         // of a variable, parameter or type; a function's result
+  Scope **scopes;       // the scope declaring it, NULL until declared
+  int count;
+  int capacity;
+};
+
+typedef struct ObjectTable_ ObjectTable;
+
+// The ids of the built-in functions and procedures and their parameters
+enum BuiltinId
+{
+  READC_ID,
+  READI_ID,
+  WRITEI_ID,
+  WRITEI_PARAM_ID,
+  WRITEC_ID,
+  WRITEC_PARAM_ID,
+  WRITELN_ID,
+  WRITED_ID,
+  WRITED_PARAM_ID,
+  WRITES_ID,
+  WRITES_PARAM_ID,
+  NUM_OF_BUILTIN_IDS
+};
+
+/* Names are resolved through a display: every name that has been declared
+ * maps to a stack of its bindings, innermost first. declareObject pushes a
+ * binding and exitBlock pops those of the block it leaves, so the binding
+ * on top is the one visible from the current block, however deeply it is
+ * nested. The top binding lives in the display entry itself; only the
+ * bindings it shadows are kept aside. */
+struct Binding_
 {
   Object *object;
-  struct ObjectNode_ *next;
+  int depth; // of the block that declared it
+  struct Binding_ *shadowed;
 };
 
-typedef struct ObjectNode_ ObjectNode;
+typedef struct Binding_ Binding;
 
-struct Scope_
+struct DisplayEntry_
 {
-  ObjectNode *objList;
-  Object *owner;
-  struct Scope_ *outer;
+  const char *name; // NULL for a free slot
+  Binding top;      // top.object is NULL once every binding is popped
 };
 
-typedef struct Scope_ Scope;
+typedef struct DisplayEntry_ DisplayEntry;
+
+// What the symbol table's arena is spent on, for the statistics
+enum AllocCategory
+{
+  ALLOC_OBJECT,   // objects with their attributes
+  ALLOC_SCOPE,
+  ALLOC_LIST,     // the ids of scopes' objects
+  ALLOC_TYPE,
+  ALLOC_CONSTANT, // the text of pooled strings
+  ALLOC_BINDING,  // shadowed display bindings
+  NUM_OF_ALLOC_CATEGORIES
+};
+
+/* Counters kept while compiling, reported by kplc -s. They are only kept
+ * while countingStats is set, so lookups and declarations pay nothing for
+ * them otherwise. */
+struct SymTabStats_
+{
+  long objects[OBJ_PROGRAM + 1]; // by ObjectKind
+  long scopes;
+  int maxDepth;
+  long lookups;        // lookupObject calls
+  long lookupSteps;    // display slots and built-ins they looked at
+  long builtinLookups; // lookups that ended in the built-ins
+  long freshChecks;    // checkFreshIdent calls
+  long constants;      // constant values made, before pooling
+  size_t bytes[NUM_OF_ALLOC_CATEGORIES];
+};
+
+typedef struct SymTabStats_ SymTabStats;
+
+// Whether the thread's symbol table keeps its SymTabStats; off by default
+extern __thread int countingStats;
+
+/* While a top-level procedure or function, or the program's body, is
+ * compiled in a check session (session.h), every name it finds outside
+ * itself, in the program's scope or among the built-ins, is recorded
+ * with what it found. If each name still finds the same object, or one
+ * declared the same way, after an edit elsewhere, the unit means what it
+ * meant and need not be checked again. */
+typedef struct
+{
+  const char *name;
+  Object *object;
+} Dependency;
+
+typedef struct
+{
+  Dependency *items; // malloc'd; by name once finished
+  int count;
+  int capacity;
+} DependencyList;
 
 struct SymTab_
 {
   Object *program;
   Scope *currentScope;
-  ObjectNode *globalObjectList;
+  int depth;             // of currentScope, 0 outside the program
+  DisplayEntry *display; // open addressing, by interned name
+  int displaySize;
+  int displayCount;
+  Type **arrayTypes;     // interned array types, open addressing
+  int arrayTypesSize;
+  int arrayTypeCount;
+  ObjectTable objects;
+  ConstantPool constants;
+  SymTabStats stats;
+  DependencyList *dependencies; // recording into this when not NULL
 };
 
 typedef struct SymTab_ SymTab;
@@ -163,28 +295,41 @@ Type *makeDoubleType(void);
 Type *makeStringType(void);
 
 Type *makeArrayType(int arraySize, Type *elementType);
-Type *duplicateType(Type *type);
 int compareType(Type *type1, Type *type2);
-void freeType(Type *type);
-
-ConstantValue *makeIntConstant(int i);
-ConstantValue *makeCharConstant(char ch);
-ConstantValue *makeDoubleConstant(double db);
-ConstantValue *makeStringConstant(char *str);
 
-ConstantValue *duplicateConstantValue(ConstantValue *v);
+// These return the pooled value, adding it if it is new
+ConstantId makeIntConstant(int i);
+ConstantId makeCharConstant(char ch);
+ConstantId makeDoubleConstant(double db);
+ConstantId makeStringConstant(const char *str, int length);
+ConstantId negateConstant(ConstantId id);
+// Valid until the next value is added to the pool
+ConstantValue *constantValue(ConstantId id);
 
 Scope *createScope(Object *owner, Scope *outer);
 
-Object *createProgramObject(char *programName);
-Object *createConstantObject(char *name);
-Object *createTypeObject(char *name);
-Object *createVariableObject(char *name);
-Object *createFunctionObject(char *name);
-Object *createProcedureObject(char *name);
-Object *createParameterObject(char *name, enum ParamKind kind, Object *owner);
-
-Object *findObject(ObjectNode *objList, char *name);
+Object *createProgramObject(const char *programName);
+Object *createConstantObject(const char *name);
+Object *createTypeObject(const char *name);
+Object *createVariableObject(const char *name);
+Object *createFunctionObject(const char *name);
+Object *createProcedureObject(const char *name);
+Object *createParameterObject(const char *name, enum ParamKind kind, Object *owner);
+
+Type *objectType(Object *obj);
+void setObjectType(Object *obj, Type *type);
+// The i-th object a scope declares
+Object *scopeObject(Scope *scope, int i);
+// The parameters of a function or procedure
+int countParams(Object *obj);
+Object *getParam(Object *obj, int i);
+
+// Names given to the symbol table are interned, and compared as pointers
+Object *findObject(Scope *scope, const char *name);
+// The object a name denotes in the current block, built-ins included, or NULL
+Object *findVisibleObject(const char *name);
+// The same, but only if it is declared by the current block itself
+Object *findLocalObject(const char *name);
 
 void initSymTab(void);
 void cleanSymTab(void);
@@ -192,4 +337,15 @@ void enterBlock(Scope *scope);
 void exitBlock(void);
 void declareObject(Object *obj);
 
+// Enters scope again with only its first count objects
+void reopenBlock(Scope *scope, int count);
+// Sorts a recorded list by name and drops repeats and owner itself
+void finishDependencies(DependencyList *list, Object *owner);
+void freeDependencies(DependencyList *list);
+// Whether code using obj1 would compile the same against obj2: the same
+// kind, and for procedures and functions the same parameters and result
+int sameDeclaration(Object *obj1, Object *obj2);
+// Bytes taken from the symbol table's arena so far
+size_t symtabMemory(void);
+
 #endif
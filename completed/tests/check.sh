@@ -0,0 +1,88 @@
+#! /bin/bash
+# Runs every example*.kpl, the programs in bench/vm and the ones here each
+# way the tree can run them: as bytecode on kplvm with switch and with
+# threaded dispatch, and as a native executable, each compiled with
+# constants folded and without (kplc -O 0). What a run prints, and the
+# status it exits with, must be what expected/NAME.out holds. A program
+# reads NAME.in here if there is one, and nothing otherwise. One with no
+# expected/NAME.out, such as example5's, has errors kplc must report.
+# Where there is an expected/NAME.lst, the listing kplc prints as it
+# checks the program must be that too.
+#
+#   ./check.sh [-u]
+#
+# -u writes expected/NAME.out afresh from the folded switch run, for a
+# new program; check every line of it by hand before adding it.
+
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+TESTS="$HERE/tests"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+UPDATE=0
+[ "$1" = "-u" ] && UPDATE=1
+
+[ -x "$HERE/kplc" ] && [ -x "$HERE/kplvm" ] && [ -f "$HERE/kplrt.o" ] || {
+  echo "check: build kplc, kplvm and kplrt.o first (make all)."
+  exit 1
+}
+
+# run NAME COMMAND...: what the command prints, then the status it exits with
+run() {
+  local name=$1 input=/dev/null
+  shift
+  [ -f "$TESTS/$name.in" ] && input="$TESTS/$name.in"
+  "$@" < "$input" 2> /dev/null
+  echo "[exit $?]"
+}
+
+runs=0
+failures=0
+for program in "$HERE"/example*.kpl "$HERE"/bench/vm/*.kpl "$TESTS"/*.kpl; do
+  name=$(basename "$program" .kpl)
+  expected="$TESTS/expected/$name.out"
+  if [ ! -f "$expected" ] && [ $UPDATE = 0 ]; then
+    runs=$((runs + 1))
+    if "$HERE/kplc" -b "$WORK/$name.kbc" "$program" > /dev/null; then
+      echo "FAIL $name: kplc compiles it, but it has no expected output"
+      failures=$((failures + 1))
+    fi
+    continue
+  fi
+  if [ -f "$TESTS/expected/$name.lst" ]; then
+    runs=$((runs + 1))
+    "$HERE/kplc" "$program" > "$WORK/$name.lst" 2>&1
+    if ! diff -q "$TESTS/expected/$name.lst" "$WORK/$name.lst" > /dev/null; then
+      echo "FAIL $name: kplc's listing"
+      diff "$TESTS/expected/$name.lst" "$WORK/$name.lst" | head -10
+      failures=$((failures + 1))
+    fi
+  fi
+  for fold in 1 0; do
+    if ! "$HERE/kplc" -O $fold -b "$WORK/$name.kbc" "$program" > /dev/null ||
+       ! "$HERE/kplc" -O $fold -o "$WORK/$name" "$program" > /dev/null; then
+      [ $UPDATE = 1 ] && break
+      echo "FAIL $name: kplc -O $fold cannot compile it"
+      failures=$((failures + 1))
+      continue
+    fi
+    if [ $UPDATE = 1 ] && [ $fold = 1 ]; then
+      run "$name" "$HERE/kplvm" -d switch "$WORK/$name.kbc" > "$expected"
+    fi
+    for way in switch threaded native; do
+      if [ $way = native ]; then
+        run "$name" "$WORK/$name" > "$WORK/$name.out"
+      else
+        run "$name" "$HERE/kplvm" -d $way "$WORK/$name.kbc" > "$WORK/$name.out"
+      fi
+      runs=$((runs + 1))
+      if ! diff -q "$expected" "$WORK/$name.out" > /dev/null 2>&1; then
+        echo "FAIL $name: $way, kplc -O $fold"
+        diff "$expected" "$WORK/$name.out" | head -10
+        failures=$((failures + 1))
+      fi
+    done
+  done
+done
+
+echo "$runs runs, $failures failed"
+[ $failures = 0 ]
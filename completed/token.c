@@ -5,70 +5,76 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include "token.h"
 
+// Keywords live in a perfect hash table indexed by their length and their
+// first and last letters, so a lookup costs one hash and at most one
+// string comparison. Two keywords landing in the same slot is a compile
+// error; change the multipliers of KEYWORD_HASH if that ever happens.
+#pragma GCC diagnostic error "-Woverride-init"
+
+#define KEYWORD_TABLE_SIZE 64
+#define KEYWORD_HASH(length, first, last) \
+  (((length) * 14 + (first) * 5 + (last) * 6) & (KEYWORD_TABLE_SIZE - 1))
+#define KEYWORD(s, first, last, type) \
+  [KEYWORD_HASH(sizeof(s) - 1, first, last)] = {s, sizeof(s) - 1, type}
+
 struct
 {
   char string[MAX_IDENT_LEN + 1];
+  int length;
   TokenType tokenType;
-} keywords[KEYWORDS_COUNT] = {
-    {"PROGRAM", KW_PROGRAM},
-    {"CONST", KW_CONST},
-    {"TYPE", KW_TYPE},
-    {"VAR", KW_VAR},
-    {"INTEGER", KW_INTEGER},
-    {"CHAR", KW_CHAR},
-    {"ARRAY", KW_ARRAY},
-    {"OF", KW_OF},
-    {"FUNCTION", KW_FUNCTION},
-    {"PROCEDURE", KW_PROCEDURE},
-    {"BEGIN", KW_BEGIN},
-    {"END", KW_END},
-    {"CALL", KW_CALL},
-    {"IF", KW_IF},
-    {"THEN", KW_THEN},
-    {"ELSE", KW_ELSE},
-    {"WHILE", KW_WHILE},
-    {"DO", KW_DO},
-    {"FOR", KW_FOR},
-    {"SWITCH", KW_SWITCH},
-    {"CASE", KW_CASE},
-    {"DEFAULT", KW_DEFAULT},
-    {"BREAK", KW_BREAK},
-    {"DOUBLE", KW_DOUBLE},
-    {"STRING", KW_STRING},
-
+} keywords[KEYWORD_TABLE_SIZE] = {
+    KEYWORD("PROGRAM", 'P', 'M', KW_PROGRAM),
+    KEYWORD("CONST", 'C', 'T', KW_CONST),
+    KEYWORD("TYPE", 'T', 'E', KW_TYPE),
+    KEYWORD("VAR", 'V', 'R', KW_VAR),
+    KEYWORD("INTEGER", 'I', 'R', KW_INTEGER),
+    KEYWORD("CHAR", 'C', 'R', KW_CHAR),
+    KEYWORD("ARRAY", 'A', 'Y', KW_ARRAY),
+    KEYWORD("OF", 'O', 'F', KW_OF),
+    KEYWORD("FUNCTION", 'F', 'N', KW_FUNCTION),
+    KEYWORD("PROCEDURE", 'P', 'E', KW_PROCEDURE),
+    KEYWORD("BEGIN", 'B', 'N', KW_BEGIN),
+    KEYWORD("END", 'E', 'D', KW_END),
+    KEYWORD("CALL", 'C', 'L', KW_CALL),
+    KEYWORD("IF", 'I', 'F', KW_IF),
+    KEYWORD("THEN", 'T', 'N', KW_THEN),
+    KEYWORD("ELSE", 'E', 'E', KW_ELSE),
+    KEYWORD("WHILE", 'W', 'E', KW_WHILE),
+    KEYWORD("DO", 'D', 'O', KW_DO),
+    KEYWORD("FOR", 'F', 'R', KW_FOR),
+    KEYWORD("TO", 'T', 'O', KW_TO),
+    KEYWORD("SWITCH", 'S', 'H', KW_SWITCH),
+    KEYWORD("CASE", 'C', 'E', KW_CASE),
+    KEYWORD("DEFAULT", 'D', 'T', KW_DEFAULT),
+    KEYWORD("BREAK", 'B', 'K', KW_BREAK),
+    KEYWORD("DOUBLE", 'D', 'E', KW_DOUBLE),
+    KEYWORD("STRING", 'S', 'G', KW_STRING),
 };
 
-int keywordEq(char *kw, char *string)
-{
-  while ((*kw != '\0') && (*string != '\0'))
-  {
-    if (*kw != *string)
-      break;
-    kw++;
-    string++;
-  }
-  return ((*kw == '\0') && (*string == '\0'));
-}
+// Folds a letter to upper case. Digits fold to control characters, which
+// no keyword contains, so they still never match.
+#define FOLD(c) ((unsigned char)(c) & ~0x20)
 
-TokenType checkKeyword(char *string)
+// string holds length letters and digits in any case; it need not be
+// terminated
+TokenType checkKeyword(const char *string, int length)
 {
-  int i;
-  for (i = 0; i < KEYWORDS_COUNT; i++)
-    if (keywordEq(keywords[i].string, string))
-      return keywords[i].tokenType;
-  return TK_NONE;
-}
+  int slot, i;
 
-Token *makeToken(TokenType tokenType, int lineNo, int colNo)
-{
-  Token *token = (Token *)malloc(sizeof(Token));
-  token->tokenType = tokenType;
-  token->lineNo = lineNo;
-  token->colNo = colNo;
-  return token;
+  if ((length < 2) || (length > MAX_IDENT_LEN))
+    return TK_NONE;
+
+  slot = KEYWORD_HASH(length, FOLD(string[0]), FOLD(string[length - 1]));
+  if (keywords[slot].length != length)
+    return TK_NONE;
+  for (i = 0; i < length; i++)
+    if (FOLD(string[i]) != keywords[slot].string[i])
+      return TK_NONE;
+  return keywords[slot].tokenType;
 }
 
 char *tokenToString(TokenType tokenType)
@@ -8,7 +8,7 @@
 #define __TOKEN_H__
 
 #define MAX_IDENT_LEN 15
-#define KEYWORDS_COUNT 27
+#define TOKEN_RING_SIZE 4
 
 typedef enum
 {
@@ -69,17 +69,23 @@ typedef enum
   SB_POWER
 } TokenType;
 
+// Identifiers, numbers, chars and strings point into the source buffer
+// rather than holding a copy: text is the identifier or number as written,
+// the character of a char constant, or the body of a string without its
+// quotes. It is not terminated, and lives as long as the input is open.
+// getToken also gives an identifier its interned name (see intern.h).
 typedef struct
 {
-  char string[MAX_IDENT_LEN + 1];
+  const char *text;
+  int length;
+  const char *name;
   int lineNo, colNo;
   TokenType tokenType;
   int value;
   double doubleValue;
 } Token;
 
-TokenType checkKeyword(char *string);
-Token *makeToken(TokenType tokenType, int lineNo, int colNo);
+TokenType checkKeyword(const char *string, int length);
 char *tokenToString(TokenType tokenType);
 
 #endif
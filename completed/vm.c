@@ -0,0 +1,171 @@
+/* Stack machine
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+#include "symtab.h"
+#include "vm.h"
+#include "power.h"
+
+static const char *runtimeErrors[] = {
+    "Stack overflow.",
+    "Invalid address.",
+    "Index out of range.",
+    "Division by zero.",
+    "Result out of the range of int."};
+
+enum RuntimeError
+{
+  RT_STACK_OVERFLOW,
+  RT_INVALID_ADDRESS,
+  RT_INDEX_OUT_OF_RANGE,
+  RT_DIVISION_BY_ZERO,
+  RT_INT_OVERFLOW
+};
+
+static int compareStrings(const char *s1, const char *s2)
+{
+  int c = strcmp((s1 == NULL) ? "" : s1, (s2 == NULL) ? "" : s2);
+
+  return (c < 0) ? -1 : (c > 0);
+}
+
+/* The strings a run makes. Cells carry no tag, so the strings still in use
+ * are found by looking through the stack: once limit of them are kept,
+ * each one no cell from 0 to t holds is freed. An int or double that
+ * happens to look like one only keeps it until a later look. Strings are
+ * only made by CAT and CVS, and never while a call's arguments are above
+ * t, waiting for the callee's INT, so no live cell is passed over. */
+typedef struct
+{
+  char **strings;
+  int count;
+  int capacity;
+  int limit;
+} StringList;
+
+#define MIN_STRING_LIMIT 256
+
+static int comparePointers(const void *p1, const void *p2)
+{
+  uintptr_t a1 = (uintptr_t)*(char *const *)p1, a2 = (uintptr_t)*(char *const *)p2;
+
+  return (a1 < a2) ? -1 : (a1 > a2);
+}
+
+static void collectStrings(StringList *list, Cell *stack, int t)
+{
+  unsigned char *live = (unsigned char *)calloc(list->count, sizeof(unsigned char));
+  char **found;
+  int i, kept = 0;
+
+  qsort(list->strings, list->count, sizeof(char *), comparePointers);
+  for (i = 0; i <= t; i++)
+  {
+    found = (char **)bsearch(&stack[i].stringValue, list->strings, list->count, sizeof(char *), comparePointers);
+    if (found != NULL)
+      live[found - list->strings] = 1;
+  }
+  for (i = 0; i < list->count; i++)
+  {
+    if (live[i])
+      list->strings[kept++] = list->strings[i];
+    else
+      free(list->strings[i]);
+  }
+  free(live);
+  list->count = kept;
+  // room for as many strings again, and more while the stack is deep, so
+  // each string made costs a bounded share of the looks
+  list->limit = 2 * kept + t / 4 + MIN_STRING_LIMIT;
+}
+
+// Keeps a new string, first freeing the ones the stack up to t no longer holds
+static char *keep(StringList *list, char *s, Cell *stack, int t)
+{
+  if (list->count >= list->limit)
+    collectStrings(list, stack, t);
+  if (list->count == list->capacity)
+  {
+    list->capacity = (list->capacity == 0) ? 64 : list->capacity * 2;
+    list->strings = (char **)realloc(list->strings, list->capacity * sizeof(char *));
+  }
+  list->strings[list->count++] = s;
+  return s;
+}
+
+static void freeStrings(StringList *list)
+{
+  int i;
+
+  for (i = 0; i < list->count; i++)
+    free(list->strings[i]);
+  free(list->strings);
+}
+
+static char *concatenate(const char *s1, const char *s2)
+{
+  size_t length1 = (s1 == NULL) ? 0 : strlen(s1);
+  size_t length2 = (s2 == NULL) ? 0 : strlen(s2);
+  char *s = (char *)malloc(length1 + length2 + 1);
+
+  if (length1 > 0)
+    memcpy(s, s1, length1);
+  if (length2 > 0)
+    memcpy(s + length1, s2, length2);
+  s[length1 + length2] = '\0';
+  return s;
+}
+
+static char *toString(Cell cell, int typeClass)
+{
+  char buffer[32];
+
+  if (typeClass == TP_DOUBLE)
+    snprintf(buffer, sizeof(buffer), "%g", cell.doubleValue);
+  else if (typeClass == TP_CHAR)
+    snprintf(buffer, sizeof(buffer), "%c", cell.intValue);
+  else
+    snprintf(buffer, sizeof(buffer), "%d", cell.intValue);
+  return strdup(buffer);
+}
+
+#ifdef VM_HAS_THREADED
+typedef struct
+{
+  const void *label; // of the code running the instruction
+  int p;
+  int q;
+} ThreadedInstruction;
+#endif
+
+#define VM_RUN runSwitched
+#include "vmloop.h"
+#undef VM_RUN
+
+#ifdef VM_HAS_THREADED
+#define VM_THREADED
+#define VM_RUN runThreaded
+#include "vmloop.h"
+#undef VM_RUN
+#undef VM_THREADED
+#endif
+
+const char *dispatchNames[NUM_OF_DISPATCHES] = {"switch", "threaded"};
+
+int runBytecode(Bytecode *bytecode, enum Dispatch dispatch, long long *executed)
+{
+#ifdef VM_HAS_THREADED
+  if (dispatch == DISPATCH_THREADED)
+    return runThreaded(bytecode, executed);
+#endif
+  return runSwitched(bytecode, executed);
+}
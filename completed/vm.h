@@ -0,0 +1,51 @@
+/* Stack machine
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include "bytecode.h"
+
+// Cells of stack a program may use
+#ifndef VM_STACK_SIZE
+#define VM_STACK_SIZE (1024 * 1024)
+#endif
+
+#define VM_SUCCESS 0
+#define VM_ERROR 2 // a runtime error, reported on stderr
+
+/* One cell of the stack, with a member for each basic TypeClass: TP_INT
+ * and TP_CHAR share intValue, as do addresses. A TP_ARRAY is a cell per
+ * element. The instructions are typed, so cells carry no tag. The strings
+ * a program makes are freed once no cell holds them (see vm.c). */
+typedef union
+{
+  int intValue;
+  double doubleValue;
+  char *stringValue; // NULL for ""
+} Cell;
+
+// Threaded dispatch needs GNU C's labels as values; elsewhere it runs as
+// switch dispatch does
+#if defined(__GNUC__) && !defined(VM_NO_THREADED)
+#define VM_HAS_THREADED
+#endif
+
+// How the machine gets from one instruction to the code of the next
+enum Dispatch
+{
+  DISPATCH_SWITCH,   // back through a switch on the op
+  DISPATCH_THREADED, // a jump straight to it (see vmloop.h)
+  NUM_OF_DISPATCHES
+};
+
+extern const char *dispatchNames[NUM_OF_DISPATCHES];
+
+// Runs the code from 0 until HL, reading stdin and writing stdout; counts
+// the instructions run in executed, unless it is NULL
+int runBytecode(Bytecode *bytecode, enum Dispatch dispatch, long long *executed);
+
+#endif
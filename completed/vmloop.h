@@ -0,0 +1,343 @@
+/* Stack machine: the interpreter's loop
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/* vm.c includes this once for each way of dispatching instructions,
+ * naming the function VM_RUN. With VM_THREADED the code is first copied
+ * into ThreadedInstructions holding the address of the label that runs
+ * each one, so every instruction ends by jumping straight to the next
+ * one's code (direct threading, with GNU C's labels as values). Without,
+ * each goes back to the top of a switch on its op. */
+
+static int VM_RUN(Bytecode *bytecode, long long *executed)
+{
+  Cell *stack = (Cell *)calloc(VM_STACK_SIZE, sizeof(Cell));
+  StringList strings = {NULL, 0, 0, MIN_STRING_LIMIT};
+  long long count = 0;
+  int t = -1, b = 0;
+  int a, p, value, result;
+  enum RuntimeError err;
+#ifdef VM_THREADED
+  // Each label is put at its op's index, whatever the order of enum OpCode;
+  // an op added to its end without a label fails the assertion
+#define LABEL(op) [op] = &&L_##op
+  static const void *const labels[] = {
+      LABEL(OP_LA), LABEL(OP_LV), LABEL(OP_LC), LABEL(OP_LK), LABEL(OP_LI), LABEL(OP_ST), LABEL(OP_INT),
+      LABEL(OP_DCT), LABEL(OP_J), LABEL(OP_FJ), LABEL(OP_HL), LABEL(OP_CALL), LABEL(OP_EP), LABEL(OP_EF),
+      LABEL(OP_CP), LABEL(OP_IX), LABEL(OP_AD), LABEL(OP_SB), LABEL(OP_ML), LABEL(OP_DV), LABEL(OP_PW), LABEL(OP_NEG),
+      LABEL(OP_EQ), LABEL(OP_NE), LABEL(OP_GT), LABEL(OP_LT), LABEL(OP_GE), LABEL(OP_LE), LABEL(OP_ADF),
+      LABEL(OP_SBF), LABEL(OP_MLF), LABEL(OP_DVF), LABEL(OP_PWF), LABEL(OP_NEGF), LABEL(OP_CMPF), LABEL(OP_CMPS),
+      LABEL(OP_CAT), LABEL(OP_CVD), LABEL(OP_CVI), LABEL(OP_CVS), LABEL(OP_RC), LABEL(OP_RI), LABEL(OP_WRC),
+      LABEL(OP_WRI), LABEL(OP_WRD), LABEL(OP_WRS), LABEL(OP_WLN)};
+#undef LABEL
+  _Static_assert(sizeof(labels) / sizeof(labels[0]) == NUM_OF_OPCODES, "every op needs a label");
+  ThreadedInstruction *code = (ThreadedInstruction *)malloc(bytecode->codeSize * sizeof(ThreadedInstruction));
+  ThreadedInstruction *ip, *instruction;
+
+  for (a = 0; a < bytecode->codeSize; a++)
+  {
+    code[a].label = labels[bytecode->code[a].op];
+    code[a].p = bytecode->code[a].p;
+    code[a].q = bytecode->code[a].q;
+  }
+
+#define CASE(op) L_##op:
+#define NEXT                    \
+  do                            \
+  {                             \
+    instruction = ip++;         \
+    count++;                    \
+    goto *instruction->label;   \
+  } while (0)
+#else
+  Instruction *code = bytecode->code;
+  Instruction *ip, *instruction;
+
+#define CASE(op) case op:
+#define NEXT continue
+#endif
+#define JUMP(target) ip = code + (target)
+
+// Checks before a push
+#define ROOM(n)                        \
+  if (t + (n) >= VM_STACK_SIZE)        \
+  {                                    \
+    err = RT_STACK_OVERFLOW;           \
+    goto fail;                         \
+  }
+#define CHECK_ADDRESS(address)            \
+  if (((address) < 0) || ((address) > t)) \
+  {                                       \
+    err = RT_INVALID_ADDRESS;             \
+    goto fail;                            \
+  }
+#define INT_OP(op) \
+  t--;             \
+  stack[t].intValue = stack[t].intValue op stack[t + 1].intValue
+// +, - and * wrap around instead of overflowing
+#define WRAPPING_OP(op) \
+  t--;                  \
+  stack[t].intValue = (int)((unsigned int)stack[t].intValue op(unsigned int) stack[t + 1].intValue)
+#define DOUBLE_OP(op) \
+  t--;                \
+  stack[t].doubleValue = stack[t].doubleValue op stack[t + 1].doubleValue
+
+  ip = code;
+#ifdef VM_THREADED
+  NEXT;
+  {
+    {
+#else
+  for (;;)
+  {
+    instruction = ip++;
+    count++;
+    switch (instruction->op)
+    {
+#endif
+    CASE(OP_LA)
+      for (a = b, p = instruction->p; p > 0; p--)
+        a = stack[a + FRAME_SL].intValue;
+      ROOM(1);
+      stack[++t].intValue = a + instruction->q;
+      NEXT;
+    CASE(OP_LV)
+      for (a = b, p = instruction->p; p > 0; p--)
+        a = stack[a + FRAME_SL].intValue;
+      a += instruction->q;
+      ROOM(1);
+      CHECK_ADDRESS(a);
+      t++;
+      stack[t] = stack[a];
+      NEXT;
+    CASE(OP_LC)
+      ROOM(1);
+      stack[++t].intValue = instruction->q;
+      NEXT;
+    CASE(OP_LK)
+      ROOM(1);
+      t++;
+      if (bytecode->pool[instruction->q].isString)
+        stack[t].stringValue = bytecode->pool[instruction->q].stringValue;
+      else
+        stack[t].doubleValue = bytecode->pool[instruction->q].doubleValue;
+      NEXT;
+    CASE(OP_LI)
+      a = stack[t].intValue;
+      CHECK_ADDRESS(a);
+      stack[t] = stack[a];
+      NEXT;
+    CASE(OP_ST)
+      a = stack[t - 1].intValue;
+      CHECK_ADDRESS(a);
+      stack[a] = stack[t];
+      t -= 2;
+      NEXT;
+    CASE(OP_INT)
+      ROOM(instruction->q);
+      for (a = t + 1 + instruction->p; a <= t + instruction->q; a++)
+        memset(&stack[a], 0, sizeof(Cell));
+      t += instruction->q;
+      NEXT;
+    CASE(OP_DCT)
+      t -= instruction->q;
+      NEXT;
+    CASE(OP_J)
+      JUMP(instruction->q);
+      NEXT;
+    CASE(OP_FJ)
+      if (stack[t--].intValue == 0)
+        JUMP(instruction->q);
+      NEXT;
+    CASE(OP_HL)
+      result = VM_SUCCESS;
+      goto done;
+    CASE(OP_CALL)
+      ROOM(FRAME_HEADER);
+      for (a = b, p = instruction->p; p > 0; p--)
+        a = stack[a + FRAME_SL].intValue;
+      stack[t + 1 + FRAME_DL].intValue = b;
+      stack[t + 1 + FRAME_RA].intValue = ip - code;
+      stack[t + 1 + FRAME_SL].intValue = a;
+      b = t + 1;
+      JUMP(instruction->q);
+      NEXT;
+    CASE(OP_EP)
+      t = b - 1;
+      JUMP(stack[b + FRAME_RA].intValue);
+      b = stack[b + FRAME_DL].intValue;
+      NEXT;
+    CASE(OP_EF)
+      t = b; // the result
+      JUMP(stack[b + FRAME_RA].intValue);
+      b = stack[b + FRAME_DL].intValue;
+      NEXT;
+    CASE(OP_CP)
+      ROOM(1);
+      stack[t + 1] = stack[t];
+      t++;
+      NEXT;
+    CASE(OP_IX)
+      if ((stack[t].intValue < 0) || (stack[t].intValue >= instruction->q))
+      {
+        err = RT_INDEX_OUT_OF_RANGE;
+        goto fail;
+      }
+      NEXT;
+
+    CASE(OP_AD)
+      WRAPPING_OP(+);
+      NEXT;
+    CASE(OP_SB)
+      WRAPPING_OP(-);
+      NEXT;
+    CASE(OP_ML)
+      WRAPPING_OP(*);
+      NEXT;
+    CASE(OP_DV)
+      if (stack[t].intValue == 0)
+      {
+        err = RT_DIVISION_BY_ZERO;
+        goto fail;
+      }
+      if ((stack[t].intValue == -1) && (stack[t - 1].intValue == INT_MIN))
+      {
+        err = RT_INT_OVERFLOW;
+        goto fail;
+      }
+      INT_OP(/);
+      NEXT;
+    CASE(OP_PW)
+      t--;
+      stack[t].intValue = intPower(stack[t].intValue, stack[t + 1].intValue);
+      NEXT;
+    CASE(OP_NEG)
+      stack[t].intValue = (int)(0u - (unsigned int)stack[t].intValue);
+      NEXT;
+    CASE(OP_EQ)
+      INT_OP(==);
+      NEXT;
+    CASE(OP_NE)
+      INT_OP(!=);
+      NEXT;
+    CASE(OP_GT)
+      INT_OP(>);
+      NEXT;
+    CASE(OP_LT)
+      INT_OP(<);
+      NEXT;
+    CASE(OP_GE)
+      INT_OP(>=);
+      NEXT;
+    CASE(OP_LE)
+      INT_OP(<=);
+      NEXT;
+
+    CASE(OP_ADF)
+      DOUBLE_OP(+);
+      NEXT;
+    CASE(OP_SBF)
+      DOUBLE_OP(-);
+      NEXT;
+    CASE(OP_MLF)
+      DOUBLE_OP(*);
+      NEXT;
+    CASE(OP_DVF)
+      DOUBLE_OP(/);
+      NEXT;
+    CASE(OP_PWF)
+      t--;
+      stack[t].doubleValue = pow(stack[t].doubleValue, stack[t + 1].intValue);
+      NEXT;
+    CASE(OP_NEGF)
+      stack[t].doubleValue = -stack[t].doubleValue;
+      NEXT;
+    CASE(OP_CMPF)
+      t--;
+      stack[t].intValue = (stack[t].doubleValue < stack[t + 1].doubleValue)   ? -1
+                          : (stack[t].doubleValue > stack[t + 1].doubleValue) ? 1
+                                                                              : 0;
+      NEXT;
+    CASE(OP_CMPS)
+      t--;
+      stack[t].intValue = compareStrings(stack[t].stringValue, stack[t + 1].stringValue);
+      NEXT;
+    CASE(OP_CAT)
+      t--;
+      stack[t].stringValue = keep(&strings, concatenate(stack[t].stringValue, stack[t + 1].stringValue), stack, t);
+      NEXT;
+    CASE(OP_CVD)
+      stack[t].doubleValue = stack[t].intValue;
+      NEXT;
+    CASE(OP_CVI)
+      // truncated, as C does, where C would give an undefined result
+      if (!(stack[t].doubleValue > (double)INT_MIN - 1) || !(stack[t].doubleValue < (double)INT_MAX + 1))
+      {
+        err = RT_INT_OVERFLOW;
+        goto fail;
+      }
+      stack[t].intValue = (int)stack[t].doubleValue;
+      NEXT;
+    CASE(OP_CVS)
+      stack[t].stringValue = keep(&strings, toString(stack[t], instruction->q), stack, t);
+      NEXT;
+
+    CASE(OP_RC)
+      ROOM(1);
+      stack[++t].intValue = getchar();
+      NEXT;
+    CASE(OP_RI)
+      ROOM(1);
+      if (scanf("%d", &value) != 1)
+        value = 0;
+      stack[++t].intValue = value;
+      NEXT;
+    CASE(OP_WRC)
+      putchar(stack[t--].intValue);
+      NEXT;
+    CASE(OP_WRI)
+      printf("%d", stack[t--].intValue);
+      NEXT;
+    CASE(OP_WRD)
+      printf("%g", stack[t--].doubleValue);
+      NEXT;
+    CASE(OP_WRS)
+      if (stack[t].stringValue != NULL)
+        fputs(stack[t].stringValue, stdout);
+      t--;
+      NEXT;
+    CASE(OP_WLN)
+      putchar('\n');
+      NEXT;
+#ifndef VM_THREADED
+    default:
+      NEXT;
+#endif
+    }
+  }
+
+fail:
+  fflush(stdout);
+  fprintf(stderr, "%d: %s\n", (int)(instruction - code), runtimeErrors[err]);
+  result = VM_ERROR;
+done:
+  if (executed != NULL)
+    *executed = count;
+  freeStrings(&strings);
+  free(stack);
+#ifdef VM_THREADED
+  free(code);
+#endif
+  return result;
+
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef ROOM
+#undef CHECK_ADDRESS
+#undef INT_OP
+#undef WRAPPING_OP
+#undef DOUBLE_OP
+}